@@ -0,0 +1 @@
+#include "AggregateComposite.hpp"
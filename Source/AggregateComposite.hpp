@@ -0,0 +1,140 @@
+#ifndef AGGREGATECOMPOSITE_H
+#define AGGREGATECOMPOSITE_H
+
+// Description:
+// Composite whose nodes cache an aggregate of their subtree (total size,
+// cost, ...). Every node knows its parent. Changing a leaf's value marks the
+// leaf's ancestors dirty, stopping at the first one already dirty: a dirty
+// node always has dirty ancestors, so nothing above it needs touching. A
+// query recomputes only dirty nodes and reuses the cached values of clean
+// children. An update followed by a root query therefore costs O(depth)
+// nodes (times their fan-out) instead of a walk over the whole tree.
+
+// Usage:
+// 1. aggregates over a large tree are read often and leaves change a few at
+// a time.
+// 2. TValue needs a default value that is the identity of operator+.
+// Not thread-safe: aggregate() writes the cache.
+
+#include "Composite.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+template<typename TValue>
+class AggregateComposite;
+
+template<typename TValue>
+class AggregateNode : public ComponentComposite {
+public:
+  virtual TValue aggregate() = 0;
+
+  AggregateComposite<TValue>* parent() const { return parent_; }
+
+protected:
+  explicit AggregateNode(std::string name) : name_(std::move(name)) { }
+
+  void invalidateAncestors() {
+    for (AggregateComposite<TValue>* node = parent_; node && !node->dirty_;
+         node = node->parent_) {
+      node->dirty_ = true;
+    }
+  }
+
+  std::string name_;
+
+private:
+  friend class AggregateComposite<TValue>;
+
+  AggregateComposite<TValue>* parent_ = nullptr;
+};
+
+template<typename TValue>
+class AggregateLeaf : public AggregateNode<TValue> {
+public:
+  AggregateLeaf(std::string name, TValue value = TValue()) :
+      AggregateNode<TValue>(std::move(name)), value_(std::move(value)) { }
+
+  void operation() override {
+    std::cout << "AggregateLeaf " << this->name_ << " operation" << std::endl;
+  }
+
+  TValue aggregate() override { return value_; }
+
+  const TValue& value() const { return value_; }
+  void setValue(TValue value) {
+    value_ = std::move(value);
+    this->invalidateAncestors();
+  }
+
+private:
+  TValue value_;
+};
+
+template<typename TValue>
+class AggregateComposite : public AggregateNode<TValue> {
+public:
+  explicit AggregateComposite(std::string name) :
+      AggregateNode<TValue>(std::move(name)) { }
+
+  // Children must be AggregateNodes of the same TValue without a parent.
+  void add(ComponentComposite* component) override {
+    auto child = dynamic_cast<AggregateNode<TValue>*>(component);
+    if (!child) {
+      throw std::invalid_argument("AggregateComposite child is not an "
+                                  "AggregateNode of the same value type");
+    }
+    if (child->parent_) {
+      throw std::logic_error("AggregateComposite child already has a parent");
+    }
+    child->parent_ = this;
+    children_.push_back(child);
+    markDirty();
+  }
+
+  void remove(ComponentComposite* component) override {
+    auto it = std::find(children_.begin(), children_.end(), component);
+    if (it == children_.end()) { return; }
+    (*it)->parent_ = nullptr;
+    children_.erase(it);
+    markDirty();
+  }
+
+  void operation() override {
+    std::cout << "AggregateComposite " << this->name_ << " operation"
+              << std::endl;
+    for (auto child : children_) { child->operation(); }
+  }
+
+  TValue aggregate() override {
+    if (dirty_) {
+      TValue total = TValue();
+      for (auto child : children_) { total = total + child->aggregate(); }
+      cached_ = std::move(total);
+      dirty_ = false;
+    }
+    return cached_;
+  }
+
+  bool dirty() const { return dirty_; }
+
+private:
+  friend class AggregateNode<TValue>;
+
+  void markDirty() {
+    if (!dirty_) {
+      dirty_ = true;
+      this->invalidateAncestors();
+    }
+  }
+
+  std::list<AggregateNode<TValue>*> children_;
+  TValue cached_ = TValue();
+  bool dirty_ = true;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#include "AsyncMemento.hpp"
+
+#include <stdexcept>
+#include <zlib.h>
+
+void compressSnapshot(const std::vector<unsigned char>& image,
+    std::vector<unsigned char>& out, int level) {
+  uLongf size = compressBound(static_cast<uLong>(image.size()));
+  out.resize(size);
+  int result = compress2(out.data(), &size, image.data(),
+      static_cast<uLong>(image.size()), level);
+  if (result != Z_OK) {
+    throw std::runtime_error("snapshot compression failed");
+  }
+  out.resize(size);
+}
+
+void decompressSnapshot(const std::vector<unsigned char>& compressed,
+    std::size_t imageSize, std::vector<unsigned char>& out) {
+  out.resize(imageSize);
+  uLongf size = static_cast<uLongf>(imageSize);
+  int result = uncompress(out.data(), &size, compressed.data(),
+      static_cast<uLong>(compressed.size()));
+  if (result != Z_OK || size != imageSize) {
+    throw std::runtime_error("snapshot decompression failed");
+  }
+}
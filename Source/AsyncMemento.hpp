@@ -0,0 +1,237 @@
+#ifndef ASYNCMEMENTO_H
+#define ASYNCMEMENTO_H
+
+// Description:
+// Caretaker whose saveState() doesn't serialize anything on the caller's
+// thread. The call only freezes the originator's state by copying it, which
+// is O(1) when TState is built from persistent structures (PersistentVector):
+// later writes copy the touched nodes instead of overwriting the frozen ones.
+// A background thread then encodes the frozen state with SnapshotCodec and
+// compresses it with zlib. Every saveState() call is timed so the pause it
+// causes can be checked.
+
+// Usage:
+// 1. the originator is large and checkpoints happen inside a hot loop.
+// 2. snapshots are kept compressed in memory and restored rarely.
+// The frozen copies are created and destroyed on the caller's thread only;
+// the worker just reads them. That keeps PersistentVector's use_count() based
+// sharing correct without any extra synchronization on the nodes.
+// If encoding or compressing a checkpoint throws, restoreState() of that
+// version rethrows the exception, and so does the next wait().
+
+#include "DeltaMemento.hpp"
+#include "VersionedMemento.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// zlib helpers; level 1 is zlib's Z_BEST_SPEED.
+void compressSnapshot(const std::vector<unsigned char>& image,
+    std::vector<unsigned char>& out, int level = 1);
+void decompressSnapshot(const std::vector<unsigned char>& compressed,
+    std::size_t imageSize, std::vector<unsigned char>& out);
+
+struct CheckpointPauses {
+  std::size_t count = 0;
+  std::chrono::nanoseconds total{0};
+  std::chrono::nanoseconds max{0};
+};
+
+template<typename TState>
+class AsyncCaretaker {
+public:
+  AsyncCaretaker(VersionedOriginator<TState>* originator,
+      std::size_t capacity = 64, int compressionLevel = 1) :
+      originator_(originator), capacity_(capacity ? capacity : 1),
+      compressionLevel_(compressionLevel), worker_([this] { workerLoop(); }) { }
+
+  ~AsyncCaretaker() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    pending_.notify_all();
+    worker_.join();
+  }
+
+  AsyncCaretaker(const AsyncCaretaker&) = delete;
+  AsyncCaretaker& operator=(const AsyncCaretaker&) = delete;
+
+  // Freezes the current state and hands it to the worker. Returns the version
+  // id of the checkpoint.
+  std::uint64_t saveState() {
+    auto start = std::chrono::steady_clock::now();
+    std::uint64_t version;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      reclaimFinishedJobs();
+      version = nextVersion_++;
+      jobs_.push_back(Job{version, originator_->state(), false, {}});
+    }
+    pending_.notify_one();
+    recordPause(std::chrono::steady_clock::now() - start);
+    return version;
+  }
+
+  // Waits for the checkpoint to be compressed, then restores it.
+  void restoreState(std::uint64_t version) {
+    Snapshot snapshot;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      finished_.wait(lock, [this, version] { return isFinished(version); });
+      reclaimFinishedJobs();
+      auto it = std::find_if(snapshots_.begin(), snapshots_.end(),
+          [version](const Snapshot& s) { return s.version == version; });
+      if (it == snapshots_.end()) {
+        throw std::out_of_range(
+            "version " + std::to_string(version) + " is not kept");
+      }
+      snapshot = *it;
+    }
+    if (snapshot.error) { std::rethrow_exception(snapshot.error); }
+    decompressSnapshot(snapshot.compressed, snapshot.imageSize, image_);
+    originator_->state() = SnapshotCodec<TState>::decode(image_);
+  }
+
+  // Blocks until every checkpoint taken so far is compressed. Rethrows the
+  // first failure since the previous wait().
+  void wait() {
+    std::exception_ptr failure;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      finished_.wait(lock, [this] {
+        return std::all_of(jobs_.begin(), jobs_.end(),
+            [](const Job& job) { return job.done; });
+      });
+      reclaimFinishedJobs();
+      failure = std::exchange(failure_, nullptr);
+    }
+    if (failure) { std::rethrow_exception(failure); }
+  }
+
+  std::size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return snapshots_.size() + jobs_.size();
+  }
+
+  std::size_t compressedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t total = 0;
+    for (const Snapshot& snapshot : snapshots_) {
+      total += snapshot.compressed.size();
+    }
+    return total;
+  }
+
+  CheckpointPauses pauses() const { return pauses_; }
+
+private:
+  struct Snapshot {
+    std::uint64_t version = 0;
+    std::size_t imageSize = 0;
+    std::vector<unsigned char> compressed;
+    std::exception_ptr error;  // set when encoding or compression failed
+  };
+
+  struct Job {
+    std::uint64_t version;
+    TState frozen;
+    bool done;
+    Snapshot result;
+  };
+
+  // Jobs finish in order, so a version no longer queued is finished.
+  bool isFinished(std::uint64_t version) const {
+    for (const Job& job : jobs_) {
+      if (job.version == version) { return job.done; }
+    }
+    return true;
+  }
+
+  // Caller's thread, lock held: moves finished results out and destroys the
+  // frozen states here rather than on the worker.
+  void reclaimFinishedJobs() {
+    while (!jobs_.empty() && jobs_.front().done) {
+      if (jobs_.front().result.error && !failure_) {
+        failure_ = jobs_.front().result.error;
+      }
+      snapshots_.push_back(std::move(jobs_.front().result));
+      jobs_.pop_front();
+      if (snapshots_.size() > capacity_) { snapshots_.pop_front(); }
+    }
+  }
+
+  void recordPause(std::chrono::steady_clock::duration pause) {
+    auto nanoseconds =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(pause);
+    ++pauses_.count;
+    pauses_.total += nanoseconds;
+    pauses_.max = std::max(pauses_.max, nanoseconds);
+  }
+
+  void workerLoop() {
+    std::vector<unsigned char> image;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      pending_.wait(lock, [this] { return stopping_ || nextJob() != nullptr; });
+      Job* job = nextJob();
+      if (!job) { return; }  // stopping and nothing left
+      lock.unlock();
+
+      // Jobs are only popped once done, so the reference stays valid.
+      Snapshot result;
+      result.version = job->version;
+      try {
+        SnapshotCodec<TState>::encode(job->frozen, image);
+        result.imageSize = image.size();
+        compressSnapshot(image, result.compressed, compressionLevel_);
+      } catch (...) {
+        // An exception escaping the worker would terminate the process.
+        result.error = std::current_exception();
+        result.compressed.clear();
+      }
+
+      lock.lock();
+      job->result = std::move(result);
+      job->done = true;
+      finished_.notify_all();
+    }
+  }
+
+  Job* nextJob() {
+    for (Job& job : jobs_) {
+      if (!job.done) { return &job; }
+    }
+    return nullptr;
+  }
+
+  VersionedOriginator<TState>* originator_;
+  std::size_t capacity_;
+  int compressionLevel_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable pending_;
+  std::condition_variable finished_;
+  std::deque<Job> jobs_;
+  std::deque<Snapshot> snapshots_;
+  std::uint64_t nextVersion_ = 0;
+  bool stopping_ = false;
+  std::exception_ptr failure_;  // reported by the next wait()
+
+  CheckpointPauses pauses_;
+  std::vector<unsigned char> image_;
+  std::thread worker_;  // last: started once everything else exists
+};
+
+#endif
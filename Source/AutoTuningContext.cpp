@@ -0,0 +1 @@
+#include "AutoTuningContext.hpp"
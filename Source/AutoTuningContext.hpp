@@ -0,0 +1,204 @@
+#ifndef AUTOTUNINGCONTEXT_H
+#define AUTOTUNINGCONTEXT_H
+
+// Description:
+// Context that picks its strategy by measuring. Inputs are grouped into
+// power-of-two size buckets. For each bucket the context first probes: it
+// runs every candidate a few times on live inputs and times them, then keeps
+// the one with the lowest time per element. After reprobeInterval calls in a
+// bucket it probes again, so the choice follows changes in load or hardware.
+// Outside probing the chosen candidate runs untimed.
+
+// Usage:
+// 1. several algorithms compute the same result and which one is fastest
+// depends on the input size and the machine (sorts, matrix kernels, FFTs).
+// 2. you want to see what was chosen: decisions() and exportDecisions().
+// Not thread-safe; use one context per thread.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ContainerSize {
+  template<typename T>
+  std::size_t operator()(const T& input) const { return input.size(); }
+};
+
+template<typename TInput, typename TSizeOf = ContainerSize>
+class AutoTuningContext {
+public:
+  using Candidate = std::function<void(TInput&)>;
+
+  struct Decision {
+    std::size_t minSize;
+    std::size_t maxSize;
+    std::string choice;  // empty while the first probe is running
+    bool probing;
+    std::uint64_t calls;
+    std::vector<double> nanosecondsPerElement;  // last probe, per candidate
+  };
+
+  explicit AutoTuningContext(std::size_t samplesPerCandidate = 3,
+      std::size_t reprobeInterval = 10000, TSizeOf sizeOf = TSizeOf()) :
+      samplesPerCandidate_(samplesPerCandidate ? samplesPerCandidate : 1),
+      reprobeInterval_(reprobeInterval ? reprobeInterval : 1),
+      sizeOf_(std::move(sizeOf)) { }
+
+  // Adding a candidate discards what was learned so far.
+  void add(std::string name, Candidate candidate) {
+    names_.push_back(std::move(name));
+    candidates_.push_back(std::move(candidate));
+    buckets_.clear();
+  }
+
+  void contextInterface(TInput& input) {
+    if (candidates_.empty()) {
+      throw std::logic_error("AutoTuningContext has no candidates");
+    }
+    std::size_t size = sizeOf_(input);
+    Bucket& bucket = bucketFor(size);
+    ++bucket.calls;
+    if (!bucket.probing) {
+      if (++bucket.sinceProbe < reprobeInterval_) {
+        candidates_[bucket.choice](input);
+        return;
+      }
+      startProbe(bucket);
+    }
+
+    std::size_t index = bucket.probeCalls % candidates_.size();
+    auto start = std::chrono::steady_clock::now();
+    candidates_[index](input);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    Sample& sample = bucket.samples[index];
+    sample.nanoseconds += static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    sample.elements += static_cast<double>(std::max<std::size_t>(size, 1));
+    if (++bucket.probeCalls == samplesPerCandidate_ * candidates_.size()) {
+      finishProbe(bucket);
+    }
+  }
+
+  // The candidate currently used for inputs of this size, or an empty string
+  // if none has been chosen yet.
+  std::string choiceFor(std::size_t size) const {
+    std::size_t index = bucketIndex(size);
+    if (index >= buckets_.size() || !buckets_[index].decided) { return {}; }
+    return names_[buckets_[index].choice];
+  }
+
+  std::vector<Decision> decisions() const {
+    std::vector<Decision> result;
+    for (std::size_t i = 0; i < buckets_.size(); ++i) {
+      const Bucket& bucket = buckets_[i];
+      if (bucket.calls == 0) { continue; }
+      Decision decision{bucketMin(i), bucketMax(i),
+          bucket.decided ? names_[bucket.choice] : std::string(),
+          bucket.probing, bucket.calls, bucket.lastProbe};
+      result.push_back(std::move(decision));
+    }
+    return result;
+  }
+
+  // CSV: one line per bucket that has seen inputs.
+  void exportDecisions(std::ostream& out) const {
+    out << "min_size,max_size,choice,probing,calls";
+    for (const std::string& name : names_) { out << ',' << name << "_ns"; }
+    out << '\n';
+    for (const Decision& decision : decisions()) {
+      out << decision.minSize << ',' << decision.maxSize << ','
+          << decision.choice << ',' << decision.probing << ','
+          << decision.calls;
+      // Left empty until the bucket's first probe has finished.
+      for (std::size_t i = 0; i < names_.size(); ++i) {
+        out << ',';
+        if (i < decision.nanosecondsPerElement.size()) {
+          out << decision.nanosecondsPerElement[i];
+        }
+      }
+      out << '\n';
+    }
+  }
+
+private:
+  struct Sample {
+    double nanoseconds = 0;
+    double elements = 0;
+  };
+
+  struct Bucket {
+    bool probing = true;
+    bool decided = false;
+    std::size_t choice = 0;
+    std::size_t probeCalls = 0;
+    std::size_t sinceProbe = 0;
+    std::uint64_t calls = 0;
+    std::vector<Sample> samples;
+    std::vector<double> lastProbe;
+  };
+
+  // Bucket i > 0 holds sizes in [2^(i-1), 2^i); bucket 0 holds size 0.
+  static std::size_t bucketIndex(std::size_t size) {
+    std::size_t index = 0;
+    while (size) {
+      ++index;
+      size >>= 1;
+    }
+    return index;
+  }
+  static std::size_t bucketMin(std::size_t index) {
+    return index == 0 ? 0 : std::size_t(1) << (index - 1);
+  }
+  static std::size_t bucketMax(std::size_t index) {
+    if (index == 0) { return 0; }
+    if (index == std::numeric_limits<std::size_t>::digits) {
+      return std::numeric_limits<std::size_t>::max();
+    }
+    return (std::size_t(1) << index) - 1;
+  }
+
+  Bucket& bucketFor(std::size_t size) {
+    std::size_t index = bucketIndex(size);
+    if (index >= buckets_.size()) { buckets_.resize(index + 1); }
+    Bucket& bucket = buckets_[index];
+    if (bucket.samples.empty()) { bucket.samples.resize(candidates_.size()); }
+    return bucket;
+  }
+
+  void startProbe(Bucket& bucket) {
+    bucket.probing = true;
+    bucket.probeCalls = 0;
+    std::fill(bucket.samples.begin(), bucket.samples.end(), Sample());
+  }
+
+  void finishProbe(Bucket& bucket) {
+    bucket.lastProbe.resize(candidates_.size());
+    for (std::size_t i = 0; i < candidates_.size(); ++i) {
+      const Sample& sample = bucket.samples[i];
+      bucket.lastProbe[i] = sample.nanoseconds / sample.elements;
+    }
+    bucket.choice = static_cast<std::size_t>(
+        std::min_element(bucket.lastProbe.begin(), bucket.lastProbe.end()) -
+        bucket.lastProbe.begin());
+    bucket.probing = false;
+    bucket.decided = true;
+    bucket.sinceProbe = 0;
+  }
+
+  std::size_t samplesPerCandidate_;
+  std::size_t reprobeInterval_;
+  TSizeOf sizeOf_;
+  std::vector<std::string> names_;
+  std::vector<Candidate> candidates_;
+  std::vector<Bucket> buckets_;
+};
+
+#endif
@@ -0,0 +1 @@
+#include "BatchingProxy.hpp"
@@ -0,0 +1,198 @@
+#ifndef BATCHINGPROXY_H
+#define BATCHINGPROXY_H
+
+// Description:
+// Proxy for subjects that are expensive per call but cheap per item when
+// called in bulk. Request() queues a single item and returns a future right
+// away. Dispatcher threads collect the queued items into batches and forward
+// each batch as one bulk call. A batch leaves when it reaches maxBatch items
+// or when its oldest item has waited maxDelay. The i-th result of the bulk
+// call fulfils the i-th caller's future. With more than one dispatcher,
+// several batches can be in flight at once (pipelining), while callers keep
+// queueing the next one.
+
+// Usage:
+// 1. the subject is a remote service, a database or a device with a fixed
+// cost per round trip.
+// 2. many threads issue small independent requests.
+// maxDelay bounds the extra latency a lone request pays for batching. If the
+// bulk call throws or returns the wrong number of results, every future of
+// that batch receives the exception.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+template<typename TRequest, typename TResult>
+class BatchingProxy {
+public:
+  using BulkSubject =
+      std::function<std::vector<TResult>(const std::vector<TRequest>&)>;
+
+  BatchingProxy(BulkSubject subject, std::size_t maxBatch = 64,
+      std::chrono::microseconds maxDelay = std::chrono::milliseconds(1),
+      std::size_t dispatchers = 1) :
+      subject_(std::move(subject)), maxBatch_(maxBatch ? maxBatch : 1),
+      maxDelay_(maxDelay) {
+    if (dispatchers == 0) { dispatchers = 1; }
+    dispatchers_.reserve(dispatchers);
+    for (std::size_t i = 0; i < dispatchers; ++i) {
+      dispatchers_.emplace_back([this] { dispatchLoop(); });
+    }
+  }
+
+  // Sends whatever is still queued, then stops.
+  ~BatchingProxy() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    ready_.notify_all();
+    for (std::thread& dispatcher : dispatchers_) { dispatcher.join(); }
+  }
+
+  BatchingProxy(const BatchingProxy&) = delete;
+  BatchingProxy& operator=(const BatchingProxy&) = delete;
+
+  std::future<TResult> Request(TRequest request) {
+    std::promise<TResult> promise;
+    std::future<TResult> result = promise.get_future();
+    bool wake;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (requests_.empty()) { oldest_ = Clock::now(); }
+      requests_.push_back(std::move(request));
+      promises_.push_back(std::move(promise));
+      // The first item sets a deadline, a full batch is due now.
+      wake = requests_.size() == 1 || requests_.size() == maxBatch_;
+    }
+    if (wake) { ready_.notify_one(); }
+    return result;
+  }
+
+  // Sends the queued items without waiting for maxDelay.
+  void flush() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      flushing_ = !requests_.empty();
+    }
+    ready_.notify_one();
+  }
+
+  std::uint64_t batchCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return batches_;
+  }
+
+  std::uint64_t requestCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return forwarded_;
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  bool batchDue() const {
+    return requests_.size() >= maxBatch_ ||
+           (!requests_.empty() &&
+               (stopping_ || flushing_ || Clock::now() >= oldest_ + maxDelay_));
+  }
+
+  void dispatchLoop() {
+    std::vector<TRequest> batch;
+    std::vector<std::promise<TResult>> promises;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      while (!batchDue()) {
+        if (stopping_) { return; }  // and nothing queued
+        if (requests_.empty()) {
+          ready_.wait(lock);
+        } else {
+          ready_.wait_until(lock, oldest_ + maxDelay_);
+        }
+      }
+      take(batch, promises);
+      ++batches_;
+      forwarded_ += batch.size();
+      lock.unlock();
+      forward(batch, promises);
+      batch.clear();
+      promises.clear();
+      lock.lock();
+    }
+  }
+
+  // Lock held. Moves up to maxBatch_ of the oldest items out. The queues
+  // are deques, so this costs O(batch) however long the backlog is.
+  void take(std::vector<TRequest>& batch,
+      std::vector<std::promise<TResult>>& promises) {
+    auto count = static_cast<std::ptrdiff_t>(
+        std::min(requests_.size(), maxBatch_));
+    batch.assign(std::make_move_iterator(requests_.begin()),
+        std::make_move_iterator(requests_.begin() + count));
+    promises.assign(std::make_move_iterator(promises_.begin()),
+        std::make_move_iterator(promises_.begin() + count));
+    requests_.erase(requests_.begin(), requests_.begin() + count);
+    promises_.erase(promises_.begin(), promises_.begin() + count);
+    if (requests_.empty()) {
+      flushing_ = false;
+    } else {
+      // oldest_ stays: the rest is never older than it, so keeping it can
+      // only send the rest early, never late.
+      ready_.notify_one();
+    }
+  }
+
+  void forward(const std::vector<TRequest>& batch,
+      std::vector<std::promise<TResult>>& promises) {
+    try {
+      std::vector<TResult> results = subject_(batch);
+      if (results.size() != batch.size()) {
+        throw std::logic_error("bulk subject returned " +
+                               std::to_string(results.size()) +
+                               " results for " + std::to_string(batch.size()) +
+                               " requests");
+      }
+      for (std::size_t i = 0; i < promises.size(); ++i) {
+        promises[i].set_value(std::move(results[i]));
+      }
+    } catch (...) {
+      std::exception_ptr error = std::current_exception();
+      for (std::promise<TResult>& promise : promises) {
+        try {
+          promise.set_exception(error);
+        } catch (const std::future_error&) { }  // already satisfied
+      }
+    }
+  }
+
+  BulkSubject subject_;
+  const std::size_t maxBatch_;
+  const std::chrono::microseconds maxDelay_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<TRequest> requests_;
+  std::deque<std::promise<TResult>> promises_;
+  Clock::time_point oldest_;
+  bool flushing_ = false;
+  bool stopping_ = false;
+  std::uint64_t batches_ = 0;
+  std::uint64_t forwarded_ = 0;
+  std::vector<std::thread> dispatchers_;  // last: started once all is set up
+};
+
+#endif
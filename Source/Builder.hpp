@@ -19,15 +19,24 @@
 
 #include <iostream>
 #include <string>
+#include <utility>
 
 // Product class is the final object that will be created by the builder
 class Product {
 public:
+  Product() = default;
+  Product(std::string partA, std::string partB, std::string partC) :
+      m_partA(std::move(partA)), m_partB(std::move(partB)),
+      m_partC(std::move(partC)) { }
+
   void setPartA(const std::string& partA) { m_partA = partA; }
+  void setPartA(std::string&& partA) { m_partA = std::move(partA); }
 
   void setPartB(const std::string& partB) { m_partB = partB; }
+  void setPartB(std::string&& partB) { m_partB = std::move(partB); }
 
   void setPartC(const std::string& partC) { m_partC = partC; }
+  void setPartC(std::string&& partC) { m_partC = std::move(partC); }
 
   void show() const {
     std::cout << "Product Parts: " << m_partA << ", " << m_partB << ", "
@@ -54,22 +63,73 @@ public:
 // ConcreteBuilder class is the concrete class that will implement the Builder
 class ConcreteBuilder : public Builder {
 public:
-  ConcreteBuilder() : m_product(new Product()) {
+  ConcreteBuilder() {
     std::cout << "ConcreteBuilder instantiated" << std::endl;
   }
 
-  ~ConcreteBuilder() { delete m_product; }
+  void buildPart1() override { m_product.setPartA("Part A"); }
+
+  void buildPart2() override { m_product.setPartB("Part B"); }
+
+  void buildPart3() override { m_product.setPartC("Part C"); }
 
-  void buildPart1() override { m_product->setPartA("Part A"); }
+  Product getProduct() override { return m_product; }
+
+private:
+  Product m_product;
+};
+
+// Fluent builder that keeps the parts inline and hands them over by move:
+//   Product product = FluentBuilder().partA("A").partB("B").partC("C")
+//                         .build();
+// or, for a named builder, std::move(builder).build(). It is move-only, so
+// the parts are never copied by accident. Parts are taken by value and moved
+// into place, so a temporary string is never copied; short parts stay in
+// std::string's small buffer and don't allocate at all.
+class FluentBuilder {
+public:
+  FluentBuilder() = default;
+  FluentBuilder(const FluentBuilder&) = delete;
+  FluentBuilder& operator=(const FluentBuilder&) = delete;
+  FluentBuilder(FluentBuilder&&) = default;
+  FluentBuilder& operator=(FluentBuilder&&) = default;
+
+  FluentBuilder& partA(std::string value) & {
+    m_partA = std::move(value);
+    return *this;
+  }
+  FluentBuilder&& partA(std::string value) && {
+    m_partA = std::move(value);
+    return std::move(*this);
+  }
 
-  void buildPart2() override { m_product->setPartB("Part B"); }
+  FluentBuilder& partB(std::string value) & {
+    m_partB = std::move(value);
+    return *this;
+  }
+  FluentBuilder&& partB(std::string value) && {
+    m_partB = std::move(value);
+    return std::move(*this);
+  }
 
-  void buildPart3() override { m_product->setPartC("Part C"); }
+  FluentBuilder& partC(std::string value) & {
+    m_partC = std::move(value);
+    return *this;
+  }
+  FluentBuilder&& partC(std::string value) && {
+    m_partC = std::move(value);
+    return std::move(*this);
+  }
 
-  Product getProduct() override { return *m_product; }
+  // Only on an rvalue: the builder is spent afterwards.
+  Product build() && {
+    return Product(std::move(m_partA), std::move(m_partB), std::move(m_partC));
+  }
 
 private:
-  Product* m_product;
+  std::string m_partA;
+  std::string m_partB;
+  std::string m_partC;
 };
 
 // Director class is the class that will direct the builder to build the product
@@ -0,0 +1 @@
+#include "CachingProxy.hpp"
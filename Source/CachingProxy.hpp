@@ -0,0 +1,248 @@
+#ifndef CACHINGPROXY_H
+#define CACHINGPROXY_H
+
+// Description:
+// Proxy that caches the answers of a keyed subject. The cache is split into
+// shards, each one an LRU list with its own mutex, so threads asking for
+// different keys rarely contend. Entries expire after a time-to-live and the
+// least recently used ones are evicted once a shard exceeds its share of the
+// memory budget. Misses are coalesced (single flight): while the subject is
+// computing a key, further requests for the same key wait for that result
+// instead of calling the subject again.
+
+// Usage:
+// 1. the subject is slow or remote and the same keys are asked repeatedly.
+// 2. bursts of identical requests must not all reach the subject.
+// The weigher estimates the memory an entry costs; the default counts
+// sizeof(TKey) + sizeof(TValue) plus the bookkeeping. Pass a weigher for
+// values that own heap memory (strings, vectors). Exceptions thrown by the
+// subject reach every coalesced caller and nothing is cached.
+// invalidate() and clear() also cover misses in flight: a value computed
+// before the invalidation still answers the callers already waiting for it,
+// but isn't cached, and later requests start a new subject call.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct CachingProxyStats {
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;     // subject calls
+  std::uint64_t coalesced = 0;  // misses that waited for another call
+  std::uint64_t evictions = 0;
+  std::uint64_t expirations = 0;
+};
+
+template<typename TKey, typename TValue, typename THash = std::hash<TKey>>
+class CachingProxy {
+public:
+  using Subject = std::function<TValue(const TKey&)>;
+  using Weigher = std::function<std::size_t(const TKey&, const TValue&)>;
+  using Clock = std::chrono::steady_clock;
+
+  // maxBytes is split evenly over the shards; there are never more shards
+  // than bytes, so every shard gets some budget. An entry heavier than its
+  // shard's share (about maxBytes / shardCount) is returned but not cached:
+  // use fewer shards for caches of a few large values.
+  CachingProxy(Subject subject, std::size_t maxBytes, Clock::duration ttl,
+      std::size_t shardCount = 16, Weigher weigher = Weigher()) :
+      subject_(std::move(subject)), ttl_(ttl),
+      weigher_(weigher ? std::move(weigher) : Weigher(defaultWeigher)),
+      shards_(std::max<std::size_t>(1, std::min(shardCount, maxBytes))) {
+    const std::size_t share = maxBytes / shards_.size();
+    const std::size_t remainder = maxBytes % shards_.size();
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+      shards_[i].maxBytes = share + (i < remainder ? 1 : 0);
+    }
+  }
+
+  CachingProxy(const CachingProxy&) = delete;
+  CachingProxy& operator=(const CachingProxy&) = delete;
+
+  TValue Request(const TKey& key) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found != shard.index.end()) {
+      auto entry = found->second;
+      if (Clock::now() < entry->expires) {
+        shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+        ++shard.stats.hits;
+        return entry->value;
+      }
+      ++shard.stats.expirations;
+      erase(shard, entry);
+    }
+
+    auto flight = shard.flights.find(key);
+    if (flight != shard.flights.end()) {
+      std::shared_future<TValue> pending = flight->second.result;
+      ++shard.stats.coalesced;
+      lock.unlock();
+      return pending.get();
+    }
+
+    std::promise<TValue> promise;
+    const std::uint64_t generation = ++shard.generation;
+    shard.flights.emplace(
+        key, Flight{promise.get_future().share(), generation});
+    ++shard.stats.misses;
+    lock.unlock();
+
+    try {
+      TValue value = subject_(key);
+      lock.lock();
+      // Cached only if no invalidate() or clear() removed the flight.
+      if (landFlight(shard, key, generation)) { insert(shard, key, value); }
+      lock.unlock();
+      promise.set_value(value);
+      return value;
+    } catch (...) {
+      if (!lock.owns_lock()) { lock.lock(); }
+      landFlight(shard, key, generation);
+      lock.unlock();
+      promise.set_exception(std::current_exception());
+      throw;
+    }
+  }
+
+  void invalidate(const TKey& key) {
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found != shard.index.end()) { erase(shard, found->second); }
+    shard.flights.erase(key);
+  }
+
+  void clear() {
+    for (Shard& shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.index.clear();
+      shard.lru.clear();
+      shard.flights.clear();
+      shard.bytes = 0;
+    }
+  }
+
+  std::size_t size() const {
+    return sum([](const Shard& shard) { return shard.lru.size(); });
+  }
+
+  // As estimated by the weigher.
+  std::size_t memoryUsage() const {
+    return sum([](const Shard& shard) { return shard.bytes; });
+  }
+
+  CachingProxyStats stats() const {
+    CachingProxyStats total;
+    for (const Shard& shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      total.hits += shard.stats.hits;
+      total.misses += shard.stats.misses;
+      total.coalesced += shard.stats.coalesced;
+      total.evictions += shard.stats.evictions;
+      total.expirations += shard.stats.expirations;
+    }
+    return total;
+  }
+
+private:
+  struct Entry {
+    TKey key;
+    TValue value;
+    Clock::time_point expires;
+    std::size_t bytes;
+  };
+  using EntryIterator = typename std::list<Entry>::iterator;
+
+  struct Flight {
+    std::shared_future<TValue> result;
+    std::uint64_t generation;  // tells a flight from its replacement
+  };
+
+  // Padded so neighbouring shards' mutexes don't share a cache line.
+  struct alignas(64) Shard {
+    mutable std::mutex mutex;
+    std::list<Entry> lru;  // most recently used first
+    std::unordered_map<TKey, EntryIterator, THash> index;
+    std::unordered_map<TKey, Flight, THash> flights;
+    std::uint64_t generation = 0;  // of the latest flight
+    std::size_t bytes = 0;
+    std::size_t maxBytes = 0;
+    CachingProxyStats stats;
+  };
+
+  // The list node holds the Entry, the index node a key and an iterator.
+  static std::size_t defaultWeigher(const TKey&, const TValue&) {
+    return sizeof(Entry) + 2 * sizeof(void*) + sizeof(TKey) +
+           sizeof(EntryIterator);
+  }
+
+  Shard& shardFor(const TKey& key) {
+    // Mix the hash: std::hash of an integer is the integer itself.
+    std::uint64_t hash =
+        static_cast<std::uint64_t>(THash()(key)) * 0x9e3779b97f4a7c15ull;
+    return shards_[static_cast<std::size_t>(hash >> 32) % shards_.size()];
+  }
+
+  // Lock held. An entry larger than the whole shard isn't cached.
+  void insert(Shard& shard, const TKey& key, const TValue& value) {
+    std::size_t bytes = weigher_(key, value);
+    if (bytes > shard.maxBytes) { return; }
+    auto found = shard.index.find(key);
+    if (found != shard.index.end()) { erase(shard, found->second); }
+    while (shard.bytes + bytes > shard.maxBytes) {
+      ++shard.stats.evictions;
+      erase(shard, std::prev(shard.lru.end()));
+    }
+    shard.lru.push_front(Entry{key, value, Clock::now() + ttl_, bytes});
+    shard.index.emplace(key, shard.lru.begin());
+    shard.bytes += bytes;
+  }
+
+  // Lock held. Removes the flight unless it was invalidated (and maybe
+  // replaced by a newer one) meanwhile; returns whether it was still current.
+  static bool landFlight(
+      Shard& shard, const TKey& key, std::uint64_t generation) {
+    auto flight = shard.flights.find(key);
+    if (flight == shard.flights.end() ||
+        flight->second.generation != generation) {
+      return false;
+    }
+    shard.flights.erase(flight);
+    return true;
+  }
+
+  void erase(Shard& shard, EntryIterator entry) {
+    shard.bytes -= entry->bytes;
+    shard.index.erase(entry->key);
+    shard.lru.erase(entry);
+  }
+
+  template<typename TField>
+  std::size_t sum(TField field) const {
+    std::size_t total = 0;
+    for (const Shard& shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      total += field(shard);
+    }
+    return total;
+  }
+
+  Subject subject_;
+  Clock::duration ttl_;
+  Weigher weigher_;
+  std::vector<Shard> shards_;
+};
+
+#endif
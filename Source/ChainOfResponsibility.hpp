@@ -1,7 +1,42 @@
 #ifndef CHAINOFRESPONSIBILITY_H
 #define CHAINOFRESPONSIBILITY_H
 
+#include <cstddef>
 #include <iostream>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Handler concept shared by the runtime chain (ConcreteChainA/B/C) and
+// StaticChain: accepts() decides whether the handler takes the request,
+// process() handles it. A handler without accepts() takes every request and
+// is therefore a terminal handler.
+struct NegativeRequestHandler {
+  bool accepts(int request) const { return request < 0; }
+  void process(int request) const {
+    std::cout << "ConcreteChainA handles request " << request << std::endl;
+  }
+};
+
+struct ZeroRequestHandler {
+  bool accepts(int request) const { return request == 0; }
+  void process(int request) const {
+    std::cout << "ConcreteChainB handles request " << request << std::endl;
+  }
+};
+
+struct PositiveRequestHandler {
+  bool accepts(int request) const { return request > 0; }
+  void process(int request) const {
+    std::cout << "ConcreteChainC handles request " << request << std::endl;
+  }
+};
+
+struct UnhandledRequestHandler {
+  void process(int request) const {
+    std::cout << "No handler for request " << request << std::endl;
+  }
+};
 
 class ChainOfResponsibility {
 public:
@@ -14,14 +49,15 @@ public:
   void setNext(ChainOfResponsibility* next) override { next_ = next; }
 
   void handle(int request) override {
-    if (request < 0) {
-      std::cout << "ConcreteChainA handles request " << request << std::endl;
+    if (handler_.accepts(request)) {
+      handler_.process(request);
     } else {
       next_->handle(request);
     }
   }
 
 private:
+  NegativeRequestHandler handler_;
   ChainOfResponsibility* next_;
 };
 
@@ -33,14 +69,15 @@ public:
   void setNext(ChainOfResponsibility* next) override { next_ = next; }
 
   void handle(int request) override {
-    if (request == 0) {
-      std::cout << "ConcreteChainB handles request " << request << std::endl;
+    if (handler_.accepts(request)) {
+      handler_.process(request);
     } else {
       next_->handle(request);
     }
   }
 
 private:
+  ZeroRequestHandler handler_;
   ChainOfResponsibility* next_;
 };
 
@@ -49,15 +86,70 @@ public:
   void setNext(ChainOfResponsibility* next) override { next_ = next; }
 
   void handle(int request) override {
-    if (request > 0) {
-      std::cout << "ConcreteChainC handles request " << request << std::endl;
+    if (handler_.accepts(request)) {
+      handler_.process(request);
     } else {
       next_->handle(request);
     }
   }
 
 private:
+  PositiveRequestHandler handler_;
   ChainOfResponsibility* next_;
 };
 
-#endif
\ No newline at end of file
+// Compile-time chain. The topology is the template argument list, so there is
+// no setNext(), no virtual call and no allocation; handle() compiles down to
+// a sequence of inlined accepts() tests. The last handler must be terminal
+// (no accepts()), which guarantees every request is handled by someone.
+//   StaticChain<NegativeRequestHandler, ZeroRequestHandler,
+//       PositiveRequestHandler, UnhandledRequestHandler> chain;
+template<typename THandler, typename = void>
+struct IsTerminalHandler : std::true_type { };
+
+template<typename THandler>
+struct IsTerminalHandler<THandler,
+    decltype(void(std::declval<const THandler&>().accepts(0)))> :
+    std::false_type { };
+
+template<typename... THandlers>
+class StaticChain {
+  static constexpr std::size_t kSize = sizeof...(THandlers);
+  static_assert(kSize > 0, "StaticChain needs at least one handler");
+  static_assert(IsTerminalHandler<std::tuple_element_t<kSize - 1,
+                    std::tuple<THandlers...>>>::value,
+      "the last handler of a StaticChain must be terminal (no accepts())");
+
+public:
+  StaticChain() = default;
+  explicit StaticChain(THandlers... handlers) :
+      handlers_(std::move(handlers)...) { }
+
+  void handle(int request) { dispatch<0>(request); }
+
+  template<std::size_t Index>
+  auto& handler() {
+    return std::get<Index>(handlers_);
+  }
+
+private:
+  template<std::size_t Index>
+  void dispatch(int request) {
+    auto& current = std::get<Index>(handlers_);
+    if constexpr (Index + 1 == kSize) {
+      current.process(request);
+    } else {
+      static_assert(!IsTerminalHandler<std::decay_t<decltype(current)>>::value,
+          "only the last handler of a StaticChain may be terminal");
+      if (current.accepts(request)) {
+        current.process(request);
+      } else {
+        dispatch<Index + 1>(request);
+      }
+    }
+  }
+
+  std::tuple<THandlers...> handlers_;
+};
+
+#endif
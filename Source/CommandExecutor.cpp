@@ -0,0 +1 @@
+#include "CommandExecutor.hpp"
@@ -0,0 +1,397 @@
+#ifndef COMMANDEXECUTOR_H
+#define COMMANDEXECUTOR_H
+
+// Description:
+// CommandExecutor runs Commands submitted from any number of producer threads
+// on a fixed pool of worker threads. Submitted commands are type-erased into
+// an InlineCommand which keeps the callable inside the queue slot itself, so
+// no heap allocation happens per submitted command. The queue is a bounded
+// multi-producer/multi-consumer ring buffer (Vyukov style, one sequence
+// counter per slot) and workers drain it in batches.
+
+// Usage:
+// 1. you want to decouple the thread that asks for work from the thread that
+// does the work (Invoker executing on someone else's thread).
+// 2. you submit many short commands from many threads and can't afford a lock
+// or an allocation per command.
+// 3. you need to know when a particular command has finished (callback or
+// future).
+
+#include "Command.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Type-erased command stored inline. The callable must fit into Capacity
+// bytes; anything bigger is rejected at compile time instead of silently
+// falling back to the heap.
+template<std::size_t Capacity>
+class InlineCommand {
+public:
+  InlineCommand() = default;
+
+  template<typename TCallable,
+      typename = std::enable_if_t<
+          !std::is_same<std::decay_t<TCallable>, InlineCommand>::value>>
+  InlineCommand(TCallable&& callable) {
+    using T = std::decay_t<TCallable>;
+    static_assert(sizeof(T) <= Capacity,
+        "command does not fit into InlineCommand storage");
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+        "command is over-aligned for InlineCommand storage");
+    static_assert(std::is_nothrow_move_constructible<T>::value,
+        "command must be nothrow move constructible");
+    new (&storage_) T(std::forward<TCallable>(callable));
+    ops_ = &opsFor<T>;
+  }
+
+  InlineCommand(InlineCommand&& other) noexcept { moveFrom(other); }
+
+  InlineCommand& operator=(InlineCommand&& other) noexcept {
+    if (this != &other) {
+      reset();
+      moveFrom(other);
+    }
+    return *this;
+  }
+
+  InlineCommand(const InlineCommand&) = delete;
+  InlineCommand& operator=(const InlineCommand&) = delete;
+
+  ~InlineCommand() { reset(); }
+
+  void operator()() { ops_->invoke(&storage_); }
+
+  explicit operator bool() const { return ops_ != nullptr; }
+
+  void reset() {
+    if (ops_) {
+      ops_->destroy(&storage_);
+      ops_ = nullptr;
+    }
+  }
+
+private:
+  struct Ops {
+    void (*invoke)(void*);
+    void (*move)(void* dst, void* src);
+    void (*destroy)(void*);
+  };
+
+  template<typename T>
+  static constexpr Ops opsFor = {
+      [](void* p) { (*static_cast<T*>(p))(); },
+      [](void* dst, void* src) {
+        new (dst) T(std::move(*static_cast<T*>(src)));
+        static_cast<T*>(src)->~T();
+      },
+      [](void* p) { static_cast<T*>(p)->~T(); }};
+
+  void moveFrom(InlineCommand& other) noexcept {
+    if (other.ops_) {
+      other.ops_->move(&storage_, &other.storage_);
+      ops_ = other.ops_;
+      other.ops_ = nullptr;
+    }
+  }
+
+  alignas(std::max_align_t) unsigned char storage_[Capacity];
+  const Ops* ops_ = nullptr;
+};
+
+// Bounded MPMC queue. Capacity is rounded up to a power of two. Every slot has
+// its own sequence number, so producers and consumers only contend on the
+// enqueue/dequeue cursors and never take a lock.
+template<typename T>
+class MpmcRingBuffer {
+public:
+  explicit MpmcRingBuffer(std::size_t capacity) :
+      mask_(roundUpToPowerOfTwo(capacity) - 1),
+      cells_(new Cell[mask_ + 1]) {
+    for (std::size_t i = 0; i <= mask_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~MpmcRingBuffer() {
+    T item;
+    while (tryPop(item)) { }
+  }
+
+  MpmcRingBuffer(const MpmcRingBuffer&) = delete;
+  MpmcRingBuffer& operator=(const MpmcRingBuffer&) = delete;
+
+  bool tryPush(T&& item) {
+    std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+      std::intptr_t diff =
+          static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueuePos_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // full
+      } else {
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    new (&cell->storage) T(std::move(item));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryPop(T& item) {
+    std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+      std::intptr_t diff = static_cast<std::intptr_t>(seq) -
+                           static_cast<std::intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeuePos_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // empty
+      } else {
+        pos = dequeuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    T* stored = reinterpret_cast<T*>(&cell->storage);
+    item = std::move(*stored);
+    stored->~T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Only a hint while producers/consumers are running.
+  bool empty() const {
+    return enqueuePos_.load(std::memory_order_acquire) ==
+           dequeuePos_.load(std::memory_order_acquire);
+  }
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+private:
+  static std::size_t roundUpToPowerOfTwo(std::size_t value) {
+    std::size_t result = 2;
+    while (result < value) { result <<= 1; }
+    return result;
+  }
+
+  struct alignas(64) Cell {
+    std::atomic<std::size_t> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  const std::size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(64) std::atomic<std::size_t> enqueuePos_{0};
+  alignas(64) std::atomic<std::size_t> dequeuePos_{0};
+};
+
+// Fixed thread pool executing Commands from an MpmcRingBuffer. A submitted
+// "command" is either a Command object (copied inline and execute()d), a
+// pointer to a Command owned by the caller (like Invoker), or any callable.
+class CommandExecutor {
+public:
+  static constexpr std::size_t kInlineCommandSize = 64;
+  using Task = InlineCommand<kInlineCommandSize>;
+
+  explicit CommandExecutor(
+      std::size_t threadCount = std::thread::hardware_concurrency(),
+      std::size_t queueCapacity = 1024, std::size_t batchSize = 32) :
+      queue_(queueCapacity), batchSize_(batchSize ? batchSize : 1) {
+    if (threadCount == 0) { threadCount = 1; }
+    workers_.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; ++i) {
+      workers_.emplace_back([this] { workerLoop(); });
+    }
+  }
+
+  ~CommandExecutor() { shutdown(); }
+
+  CommandExecutor(const CommandExecutor&) = delete;
+  CommandExecutor& operator=(const CommandExecutor&) = delete;
+
+  // Returns false when the queue is full or the executor is shut down.
+  template<typename TCommand>
+  bool trySubmit(TCommand command) {
+    if (stopping_.load(std::memory_order_acquire)) { return false; }
+    Task task(makeTask(std::move(command)));
+    submitted_.fetch_add(1, std::memory_order_acq_rel);
+    if (!queue_.tryPush(std::move(task))) {
+      submitted_.fetch_sub(1, std::memory_order_acq_rel);
+      return false;
+    }
+    wakeWorker();
+    return true;
+  }
+
+  // Blocks (yielding) while the queue is full.
+  template<typename TCommand>
+  void submit(TCommand command) {
+    if (stopping_.load(std::memory_order_acquire)) {
+      throw std::runtime_error("CommandExecutor is shut down");
+    }
+    Task task(makeTask(std::move(command)));
+    submitted_.fetch_add(1, std::memory_order_acq_rel);
+    while (!queue_.tryPush(std::move(task))) { std::this_thread::yield(); }
+    wakeWorker();
+  }
+
+  // onComplete runs on the worker thread right after the command; it is
+  // stored inline together with the command, so it must be small too.
+  template<typename TCommand, typename TCallback>
+  void submit(TCommand command, TCallback onComplete) {
+    submit([command = std::move(command),
+               onComplete = std::move(onComplete)]() mutable {
+      runCommand(command);
+      onComplete();
+    });
+  }
+
+  // The future's shared state is the one allocation on this path.
+  template<typename TCommand>
+  std::future<void> submitWithFuture(TCommand command) {
+    std::promise<void> promise;
+    std::future<void> future = promise.get_future();
+    submit([command = std::move(command),
+               promise = std::move(promise)]() mutable {
+      try {
+        runCommand(command);
+        promise.set_value();
+      } catch (...) { promise.set_exception(std::current_exception()); }
+    });
+    return future;
+  }
+
+  // Waits until every command submitted so far has been executed.
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] {
+      return completed_.load(std::memory_order_acquire) ==
+             submitted_.load(std::memory_order_acquire);
+    });
+  }
+
+  // Drains the queue and joins the workers. Producers must have stopped
+  // submitting by now; the destructor calls this as well.
+  void shutdown() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopping_.exchange(true, std::memory_order_acq_rel)) { return; }
+    }
+    wakeup_.notify_all();
+    for (auto& worker : workers_) { worker.join(); }
+  }
+
+  std::size_t executedCount() const {
+    return completed_.load(std::memory_order_acquire);
+  }
+
+  // Commands that threw; their exceptions are swallowed unless the command
+  // was submitted with submitWithFuture().
+  std::size_t failedCount() const {
+    return failed_.load(std::memory_order_acquire);
+  }
+
+private:
+  template<typename TCommand>
+  static void runCommand(TCommand& command) {
+    if constexpr (std::is_base_of<Command, TCommand>::value) {
+      command.execute();
+    } else if constexpr (std::is_pointer<TCommand>::value &&
+                         std::is_base_of<Command,
+                             std::remove_pointer_t<TCommand>>::value) {
+      command->execute();
+    } else {
+      command();
+    }
+  }
+
+  template<typename TCommand>
+  static auto makeTask(TCommand command) {
+    return [command = std::move(command)]() mutable { runCommand(command); };
+  }
+
+  void wakeWorker() {
+    // Both sides do an RMW on sleepers_: either the worker's increment reads
+    // ours (and then sees the pushed task), or we read its increment and
+    // notify it.
+    if (sleepers_.fetch_add(0, std::memory_order_acq_rel) > 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      wakeup_.notify_one();
+    }
+  }
+
+  void workerLoop() {
+    std::vector<Task> batch(batchSize_);
+    for (;;) {
+      std::size_t count = 0;
+      while (count < batchSize_ && queue_.tryPop(batch[count])) { ++count; }
+
+      if (count == 0) {
+        if (stopping_.load(std::memory_order_acquire) && queue_.empty()) {
+          return;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        sleepers_.fetch_add(1, std::memory_order_acq_rel);
+        wakeup_.wait(lock, [this] {
+          return !queue_.empty() || stopping_.load(std::memory_order_acquire);
+        });
+        sleepers_.fetch_sub(1, std::memory_order_acq_rel);
+        continue;
+      }
+
+      for (std::size_t i = 0; i < count; ++i) {
+        try {
+          batch[i]();
+        } catch (...) { failed_.fetch_add(1, std::memory_order_relaxed); }
+        batch[i].reset();
+      }
+
+      std::size_t done =
+          completed_.fetch_add(count, std::memory_order_acq_rel) + count;
+      if (done == submitted_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.notify_all();
+      }
+    }
+  }
+
+  MpmcRingBuffer<Task> queue_;
+  const std::size_t batchSize_;
+  std::vector<std::thread> workers_;
+
+  std::atomic<bool> stopping_{false};
+  std::atomic<std::size_t> submitted_{0};
+  std::atomic<std::size_t> completed_{0};
+  std::atomic<std::size_t> failed_{0};
+  std::atomic<int> sleepers_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  std::condition_variable idle_;
+};
+
+#endif
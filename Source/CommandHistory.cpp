@@ -0,0 +1 @@
+#include "CommandHistory.hpp"
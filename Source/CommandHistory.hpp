@@ -0,0 +1,430 @@
+#ifndef COMMANDHISTORY_H
+#define COMMANDHISTORY_H
+
+// Description:
+// Undo/redo for Commands. Instead of snapshotting the receiver before every
+// command, an UndoableCommand writes a small delta (just enough bytes to undo
+// and redo itself) into an append-only DeltaLog. CommandHistory keeps one
+// 16-byte entry per command pointing into that log and replays deltas through
+// per-kind undo/redo functions registered up front.
+
+// Usage:
+// 1. editors and other workflows where every action must be undoable.
+// 2. the receiver's state is large but a single command changes little of it.
+// 3. you need a bounded history: when the memory cap is hit, the oldest
+// entries are dropped and their arena chunks released.
+// 4. consecutive commands of the same kind (typing, dragging) should undo as
+// one step.
+
+#include "Command.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Append-only byte arena split into chunks. Records are addressed by logical
+// offsets which stay valid until the record is truncated or released.
+class DeltaLog {
+public:
+  explicit DeltaLog(std::size_t chunkSize = 64 * 1024) :
+      chunkSize_(chunkSize) { }
+
+  std::uint64_t append(const unsigned char* data, std::size_t size) {
+    if (chunks_.empty() ||
+        chunks_.back().capacity - chunks_.back().used < size) {
+      addChunk(size);
+    }
+    Chunk& chunk = chunks_.back();
+    std::memcpy(chunk.bytes.get() + chunk.used, data, size);
+    std::uint64_t offset = chunk.begin + chunk.used;
+    chunk.used += size;
+    return offset;
+  }
+
+  const unsigned char* data(std::uint64_t offset) const {
+    auto it = std::upper_bound(chunks_.begin(), chunks_.end(), offset,
+        [](std::uint64_t value, const Chunk& chunk) {
+          return value < chunk.begin;
+        });
+    if (it == chunks_.begin()) {
+      throw std::out_of_range("DeltaLog offset was released");
+    }
+    --it;
+    return it->bytes.get() + (offset - it->begin);
+  }
+
+  // Drops every record at or after offset.
+  void truncate(std::uint64_t offset) {
+    while (!chunks_.empty() && chunks_.back().begin >= offset &&
+           chunks_.size() > 1) {
+      chunks_.pop_back();
+    }
+    if (!chunks_.empty() && offset >= chunks_.back().begin) {
+      chunks_.back().used = static_cast<std::size_t>(
+          std::min<std::uint64_t>(chunks_.back().used,
+              offset - chunks_.back().begin));
+    }
+  }
+
+  // Frees whole chunks that only hold records before offset.
+  void releaseBefore(std::uint64_t offset) {
+    while (chunks_.size() > 1 &&
+           chunks_.front().begin + chunks_.front().used <= offset) {
+      chunks_.pop_front();
+    }
+  }
+
+  std::uint64_t end() const {
+    return chunks_.empty() ? 0 : chunks_.back().begin + chunks_.back().used;
+  }
+
+  std::size_t reservedBytes() const {
+    std::size_t total = 0;
+    for (const Chunk& chunk : chunks_) { total += chunk.capacity; }
+    return total;
+  }
+
+private:
+  struct Chunk {
+    std::uint64_t begin;
+    std::size_t used;
+    std::size_t capacity;
+    std::unique_ptr<unsigned char[]> bytes;
+  };
+
+  void addChunk(std::size_t minimum) {
+    std::size_t capacity = std::max(chunkSize_, minimum);
+    chunks_.push_back(
+        Chunk{end(), 0, capacity, std::make_unique<unsigned char[]>(capacity)});
+  }
+
+  std::size_t chunkSize_;
+  std::deque<Chunk> chunks_;
+};
+
+// Serializes a delta into a reusable staging buffer.
+class DeltaWriter {
+public:
+  template<typename T>
+  void write(const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+        "only trivially copyable values can be written to a delta");
+    writeBytes(&value, sizeof(T));
+  }
+
+  void writeBytes(const void* data, std::size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    buffer_.insert(buffer_.end(), bytes, bytes + size);
+  }
+
+  void clear() { buffer_.clear(); }
+  const unsigned char* data() const { return buffer_.data(); }
+  std::size_t size() const { return buffer_.size(); }
+
+private:
+  std::vector<unsigned char> buffer_;
+};
+
+// Reads a delta back in the order it was written.
+class DeltaReader {
+public:
+  DeltaReader(const unsigned char* data, std::size_t size) :
+      data_(data), size_(size) { }
+
+  template<typename T>
+  T read() {
+    static_assert(std::is_trivially_copyable<T>::value,
+        "only trivially copyable values can be read from a delta");
+    T value;
+    readBytes(&value, sizeof(T));
+    return value;
+  }
+
+  void readBytes(void* out, std::size_t size) {
+    if (size > remaining()) { throw std::out_of_range("delta is truncated"); }
+    std::memcpy(out, data_ + position_, size);
+    position_ += size;
+  }
+
+  // Everything left in the delta, e.g. a trailing string payload.
+  std::string readRemainingString() {
+    std::string value(reinterpret_cast<const char*>(data_ + position_),
+        remaining());
+    position_ = size_;
+    return value;
+  }
+
+  std::size_t remaining() const { return size_ - position_; }
+
+private:
+  const unsigned char* data_;
+  std::size_t size_;
+  std::size_t position_ = 0;
+};
+
+// A Command that can describe how to undo and redo what execute() did.
+// Concrete commands also provide static undo()/redo() functions taking the
+// receiver and a DeltaReader, plus a static kKind id; see registerCommand().
+class UndoableCommand : public Command {
+public:
+  virtual ~UndoableCommand() = default;
+
+  virtual std::uint16_t kind() const = 0;
+
+  // Called right after execute(); writes the delta into out.
+  virtual void writeDelta(DeltaWriter& out) const = 0;
+
+  // Called instead of writeDelta() when the previous history entry has the
+  // same kind. Writes the combined delta and returns true, or returns false
+  // to keep the commands as separate undo steps.
+  virtual bool mergeDelta(DeltaReader previous [[maybe_unused]],
+      DeltaWriter& out [[maybe_unused]]) const {
+    return false;
+  }
+};
+
+template<typename TReceiver>
+class CommandHistory {
+public:
+  using DeltaFunction = void (*)(TReceiver&, DeltaReader&);
+
+  static constexpr std::size_t kMaxMergedDelta = 4096;
+
+  explicit CommandHistory(
+      TReceiver& receiver, std::size_t memoryCap = 16 * 1024 * 1024) :
+      receiver_(receiver), memoryCap_(memoryCap) { }
+
+  void registerKind(
+      std::uint16_t kind, DeltaFunction undo, DeltaFunction redo) {
+    if (handlers_.size() <= kind) { handlers_.resize(kind + 1u); }
+    handlers_[kind] = Handler{undo, redo};
+  }
+
+  template<typename TCommand>
+  void registerCommand() {
+    registerKind(TCommand::kKind, &TCommand::undo, &TCommand::redo);
+  }
+
+  // Executes the command and records its delta. Any redo branch is dropped.
+  void execute(UndoableCommand& command) {
+    std::uint16_t kind = command.kind();
+    if (kind >= handlers_.size() || !handlers_[kind].undo) {
+      throw std::logic_error("command kind is not registered");
+    }
+    discardRedo();
+    command.execute();
+
+    staging_.clear();
+    if (mergeEnabled_ && cursor_ > 0 && entries_.back().kind == kind &&
+        entries_.back().size < kMaxMergedDelta) {
+      const Entry& previous = entries_.back();
+      DeltaReader reader(log_.data(previous.offset), previous.size);
+      if (command.mergeDelta(reader, staging_)) {
+        log_.truncate(previous.offset);
+        entries_.pop_back();
+        --cursor_;
+        push(kind);
+        compact();
+        return;
+      }
+      staging_.clear();
+    }
+    command.writeDelta(staging_);
+    push(kind);
+    compact();
+  }
+
+  bool undo() {
+    if (cursor_ == 0) { return false; }
+    const Entry& entry = entries_[--cursor_];
+    DeltaReader reader(log_.data(entry.offset), entry.size);
+    handlers_[entry.kind].undo(receiver_, reader);
+    return true;
+  }
+
+  bool redo() {
+    if (cursor_ == entries_.size()) { return false; }
+    const Entry& entry = entries_[cursor_++];
+    DeltaReader reader(log_.data(entry.offset), entry.size);
+    handlers_[entry.kind].redo(receiver_, reader);
+    return true;
+  }
+
+  bool canUndo() const { return cursor_ > 0; }
+  bool canRedo() const { return cursor_ < entries_.size(); }
+  std::size_t undoDepth() const { return cursor_; }
+  std::size_t redoDepth() const { return entries_.size() - cursor_; }
+
+  void setMergeEnabled(bool enabled) { mergeEnabled_ = enabled; }
+
+  // Bytes of delta payload still reachable plus the per-entry bookkeeping.
+  std::size_t memoryUsage() const {
+    std::uint64_t live =
+        entries_.empty() ? 0 : log_.end() - entries_.front().offset;
+    return static_cast<std::size_t>(live) + entries_.size() * sizeof(Entry);
+  }
+
+  // What the arena actually holds, including chunk slack.
+  std::size_t reservedBytes() const {
+    return log_.reservedBytes() + entries_.size() * sizeof(Entry);
+  }
+
+private:
+  struct Entry {
+    std::uint64_t offset;
+    std::uint32_t size;
+    std::uint16_t kind;
+  };
+
+  struct Handler {
+    DeltaFunction undo = nullptr;
+    DeltaFunction redo = nullptr;
+  };
+
+  void push(std::uint16_t kind) {
+    std::uint64_t offset = log_.append(staging_.data(), staging_.size());
+    entries_.push_back(
+        Entry{offset, static_cast<std::uint32_t>(staging_.size()), kind});
+    ++cursor_;
+  }
+
+  void discardRedo() {
+    if (cursor_ == entries_.size()) { return; }
+    log_.truncate(entries_[cursor_].offset);
+    entries_.erase(entries_.begin() + cursor_, entries_.end());
+  }
+
+  // Drops the oldest entries until the history fits the memory cap again.
+  // The newest entry is always kept.
+  void compact() {
+    if (memoryUsage() <= memoryCap_) { return; }
+    while (entries_.size() > 1 && memoryUsage() > memoryCap_) {
+      entries_.pop_front();
+      --cursor_;
+    }
+    log_.releaseBefore(entries_.front().offset);
+  }
+
+  TReceiver& receiver_;
+  std::size_t memoryCap_;
+  bool mergeEnabled_ = true;
+  std::vector<Handler> handlers_;
+  std::deque<Entry> entries_;
+  std::size_t cursor_ = 0;  // entries_[0, cursor_) can be undone
+  DeltaLog log_;
+  DeltaWriter staging_;
+};
+
+// Example receiver and commands: a plain text buffer edited by inserts and
+// erases. Deltas hold only the position and the affected characters.
+class TextDocument {
+public:
+  void insert(std::size_t position, const std::string& text) {
+    text_.insert(position, text);
+  }
+  void erase(std::size_t position, std::size_t count) {
+    text_.erase(position, count);
+  }
+  const std::string& text() const { return text_; }
+
+private:
+  std::string text_;
+};
+
+class InsertTextCommand : public UndoableCommand {
+public:
+  static constexpr std::uint16_t kKind = 0;
+
+  InsertTextCommand(TextDocument* document, std::size_t position,
+      std::string text) :
+      document_(document), position_(position), text_(std::move(text)) { }
+
+  void execute() override { document_->insert(position_, text_); }
+  std::uint16_t kind() const override { return kKind; }
+
+  void writeDelta(DeltaWriter& out) const override {
+    out.write(static_cast<std::uint64_t>(position_));
+    out.writeBytes(text_.data(), text_.size());
+  }
+
+  // Typing right after the previous insert extends it.
+  bool mergeDelta(DeltaReader previous, DeltaWriter& out) const override {
+    std::uint64_t position = previous.read<std::uint64_t>();
+    std::string text = previous.readRemainingString();
+    if (position + text.size() != position_) { return false; }
+    out.write(position);
+    out.writeBytes(text.data(), text.size());
+    out.writeBytes(text_.data(), text_.size());
+    return true;
+  }
+
+  static void undo(TextDocument& document, DeltaReader& delta) {
+    std::uint64_t position = delta.read<std::uint64_t>();
+    document.erase(static_cast<std::size_t>(position), delta.remaining());
+  }
+
+  static void redo(TextDocument& document, DeltaReader& delta) {
+    std::uint64_t position = delta.read<std::uint64_t>();
+    document.insert(
+        static_cast<std::size_t>(position), delta.readRemainingString());
+  }
+
+private:
+  TextDocument* document_;
+  std::size_t position_;
+  std::string text_;
+};
+
+class EraseTextCommand : public UndoableCommand {
+public:
+  static constexpr std::uint16_t kKind = 1;
+
+  EraseTextCommand(
+      TextDocument* document, std::size_t position, std::size_t count) :
+      document_(document), position_(position), count_(count) { }
+
+  void execute() override {
+    erased_ = document_->text().substr(position_, count_);
+    document_->erase(position_, count_);
+  }
+  std::uint16_t kind() const override { return kKind; }
+
+  void writeDelta(DeltaWriter& out) const override {
+    out.write(static_cast<std::uint64_t>(position_));
+    out.writeBytes(erased_.data(), erased_.size());
+  }
+
+  // Backspacing right before the previous erase extends it.
+  bool mergeDelta(DeltaReader previous, DeltaWriter& out) const override {
+    std::uint64_t position = previous.read<std::uint64_t>();
+    std::string text = previous.readRemainingString();
+    if (position_ + erased_.size() != position) { return false; }
+    out.write(static_cast<std::uint64_t>(position_));
+    out.writeBytes(erased_.data(), erased_.size());
+    out.writeBytes(text.data(), text.size());
+    return true;
+  }
+
+  static void undo(TextDocument& document, DeltaReader& delta) {
+    InsertTextCommand::redo(document, delta);
+  }
+
+  static void redo(TextDocument& document, DeltaReader& delta) {
+    InsertTextCommand::undo(document, delta);
+  }
+
+private:
+  TextDocument* document_;
+  std::size_t position_;
+  std::size_t count_;
+  std::string erased_;
+};
+
+#endif
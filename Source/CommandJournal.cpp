@@ -0,0 +1,267 @@
+#include "CommandJournal.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <zlib.h>
+
+#ifdef _WIN32
+  #include <fcntl.h>
+  #include <io.h>
+  #include <sys/stat.h>
+#else
+  #include <fcntl.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace {
+  const char kMagic[4] = {'D', 'P', 'C', 'J'};
+  const std::uint32_t kVersion = 1;
+  const std::size_t kFileHeaderSize = sizeof(kMagic) + sizeof(kVersion);
+
+  struct RecordHeader {
+    std::uint32_t payloadSize;
+    std::uint16_t type;
+    std::uint16_t reserved;
+    std::uint32_t crc;
+  };
+
+  std::uint32_t recordCrc(
+      std::uint16_t type, const unsigned char* payload, std::size_t size) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(&type), sizeof(type));
+    crc = crc32(crc, payload, static_cast<uInt>(size));
+    return static_cast<std::uint32_t>(crc);
+  }
+
+  [[noreturn]] void throwErrno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+  }
+
+  // Walks the valid records of a mapped journal. Returns the byte offset
+  // where the valid part ends (0 when the header itself is missing).
+  template<typename TVisitor>
+  std::size_t scanRecords(
+      const unsigned char* data, std::size_t size, TVisitor&& visitor) {
+    if (size < kFileHeaderSize || std::memcmp(data, kMagic, 4) != 0) {
+      return 0;
+    }
+    std::uint32_t version;
+    std::memcpy(&version, data + sizeof(kMagic), sizeof(version));
+    if (version != kVersion) {
+      throw std::runtime_error("unsupported command journal version");
+    }
+    std::size_t offset = kFileHeaderSize;
+    while (size - offset >= sizeof(RecordHeader)) {
+      RecordHeader header;
+      std::memcpy(&header, data + offset, sizeof(header));
+      const unsigned char* payload = data + offset + sizeof(header);
+      if (size - offset - sizeof(header) < header.payloadSize ||
+          recordCrc(header.type, payload, header.payloadSize) != header.crc) {
+        break;  // torn or corrupt tail
+      }
+      visitor(header.type, payload, header.payloadSize);
+      offset += sizeof(header) + header.payloadSize;
+    }
+    return offset;
+  }
+
+#ifdef _WIN32
+  int openForAppend(const std::string& path) {
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY,
+        _S_IREAD | _S_IWRITE);
+  }
+  int writeAll(int fd, const unsigned char* data, std::size_t size) {
+    while (size > 0) {
+      int written = _write(fd, data, static_cast<unsigned int>(size));
+      if (written < 0) { return -1; }
+      data += written;
+      size -= static_cast<std::size_t>(written);
+    }
+    return 0;
+  }
+  int syncFile(int fd) { return _commit(fd); }
+  int truncateFile(int fd, std::size_t size) {
+    return _chsize_s(fd, static_cast<long long>(size)) == 0 ? 0 : -1;
+  }
+  int closeFile(int fd) { return _close(fd); }
+#else
+  int openForAppend(const std::string& path) {
+    return ::open(
+        path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  }
+  int writeAll(int fd, const unsigned char* data, std::size_t size) {
+    while (size > 0) {
+      ssize_t written = ::write(fd, data, size);
+      if (written < 0) {
+        if (errno == EINTR) { continue; }
+        return -1;
+      }
+      data += written;
+      size -= static_cast<std::size_t>(written);
+    }
+    return 0;
+  }
+  int syncFile(int fd) {
+  #ifdef __APPLE__
+    return ::fsync(fd);
+  #else
+    return ::fdatasync(fd);
+  #endif
+  }
+  int truncateFile(int fd, std::size_t size) {
+    return ::ftruncate(fd, static_cast<off_t>(size));
+  }
+  int closeFile(int fd) { return ::close(fd); }
+#endif
+}  // namespace
+
+CommandJournal::CommandJournal(const std::string& path, std::size_t batchSize) :
+    path_(path), batchSize_(batchSize ? batchSize : 1) {
+  std::size_t validSize = 0;
+  std::size_t fileSize = 0;
+  {
+    MappedFile existing(path_);
+    fileSize = existing.size();
+    validSize = scanRecords(existing.data(), existing.size(),
+        [](std::uint16_t, const unsigned char*, std::size_t) { });
+    if (fileSize > 0 && validSize == 0) {
+      throw std::runtime_error(path_ + " is not a command journal");
+    }
+  }
+
+  fd_ = openForAppend(path_);
+  if (fd_ < 0) { throwErrno("cannot open " + path_); }
+
+  if (fileSize == 0) {
+    unsigned char header[kFileHeaderSize];
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    std::memcpy(header + sizeof(kMagic), &kVersion, sizeof(kVersion));
+    if (writeAll(fd_, header, sizeof(header)) != 0 || syncFile(fd_) != 0) {
+      closeFile(fd_);
+      throwErrno("cannot initialize " + path_);
+    }
+    durableOffset_ = sizeof(header);
+  } else {
+    if (validSize < fileSize &&
+        (truncateFile(fd_, validSize) != 0 || syncFile(fd_) != 0)) {
+      closeFile(fd_);
+      throwErrno("cannot cut torn tail of " + path_);
+    }
+    durableOffset_ = validSize;
+  }
+}
+
+CommandJournal::~CommandJournal() {
+  try {
+    flush();
+  } catch (...) { }
+  closeFile(fd_);
+}
+
+std::uint64_t CommandJournal::append(
+    std::uint16_t type, const unsigned char* payload, std::size_t size) {
+  RecordHeader header{static_cast<std::uint32_t>(size), type, 0,
+      recordCrc(type, payload, size)};
+  std::unique_lock<std::mutex> lock(mutex_);
+  throwIfFailed();
+  const unsigned char* headerBytes =
+      reinterpret_cast<const unsigned char*>(&header);
+  pending_.insert(pending_.end(), headerBytes, headerBytes + sizeof(header));
+  pending_.insert(pending_.end(), payload, payload + size);
+  std::uint64_t sequence = ++appendedSequence_;
+  if (++pendingRecords_ >= batchSize_ && !committing_) { commit(lock); }
+  return sequence;
+}
+
+void CommandJournal::sync(std::uint64_t sequence) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (durableSequence_ < sequence) {
+    throwIfFailed();
+    if (committing_) {
+      committed_.wait(lock);
+    } else {
+      commit(lock);
+    }
+  }
+}
+
+void CommandJournal::flush() {
+  std::uint64_t sequence;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sequence = appendedSequence_;
+  }
+  sync(sequence);
+}
+
+std::uint64_t CommandJournal::durableSequence() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return durableSequence_;
+}
+
+std::size_t CommandJournal::commitCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return commitCount_;
+}
+
+void CommandJournal::throwIfFailed() const {
+  if (failure_) { std::rethrow_exception(failure_); }
+}
+
+// Called with the lock held and no commit in flight. The batch is swapped
+// out so other threads keep appending while this one writes and syncs.
+void CommandJournal::commit(std::unique_lock<std::mutex>& lock) {
+  throwIfFailed();
+  if (pending_.empty()) {
+    durableSequence_ = appendedSequence_;
+    return;
+  }
+  committing_ = true;
+  std::vector<unsigned char> batch;
+  batch.swap(spare_);
+  batch.swap(pending_);
+  std::uint64_t target = appendedSequence_;
+  pendingRecords_ = 0;
+
+  lock.unlock();
+  int result = writeAll(fd_, batch.data(), batch.size());
+  if (result == 0) { result = syncFile(fd_); }
+  int error = errno;
+  if (result != 0) {
+    // Drop whatever part of the batch reached the file, so a torn record
+    // can't hide the records of later sessions from replay. Best effort:
+    // reopening cuts a torn tail as well.
+    if (truncateFile(fd_, durableOffset_) == 0) { syncFile(fd_); }
+  }
+  lock.lock();
+
+  const std::size_t batchSize = batch.size();
+  batch.clear();
+  spare_.swap(batch);
+  committing_ = false;
+  if (result != 0) {
+    failure_ = std::make_exception_ptr(std::system_error(
+        error, std::generic_category(), "cannot commit " + path_));
+    committed_.notify_all();
+    std::rethrow_exception(failure_);
+  }
+  durableOffset_ += batchSize;
+  durableSequence_ = target;
+  ++commitCount_;
+  committed_.notify_all();
+}
+
+std::size_t CommandJournal::replay(
+    const std::string& path, const RecordVisitor& visitor) {
+  MappedFile file(path);
+  std::size_t count = 0;
+  scanRecords(file.data(), file.size(),
+      [&](std::uint16_t type, const unsigned char* payload, std::size_t size) {
+        DeltaReader reader(payload, size);
+        visitor(type, reader);
+        ++count;
+      });
+  return count;
+}
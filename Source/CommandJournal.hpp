@@ -0,0 +1,206 @@
+#ifndef COMMANDJOURNAL_H
+#define COMMANDJOURNAL_H
+
+// Description:
+// Journaling mode for the Invoker. Every executed command is serialized into
+// a compact binary record and appended to a local log file. Records are
+// buffered and written with group commit: one write + fsync covers every
+// record appended since the previous commit. After a restart the log is
+// memory-mapped and replayed into the receiver.
+
+// Usage:
+// 1. the receiver's state must survive a crash and can be rebuilt by
+// re-executing the commands that produced it.
+// 2. commands are small and frequent, so one fsync per command is too slow.
+// 3. the log lives on a local disk (no network file systems, no locking
+// between processes).
+
+// File format (host byte order):
+//   header : "DPCJ" u32 version
+//   record : u32 payloadSize, u16 type, u16 reserved, u32 crc32, payload
+// A torn or corrupt tail record ends the valid part of the log; it is cut off
+// when the journal is reopened for writing.
+// A failed write or fsync cuts the file back to the end of the last durable
+// batch and puts the journal into a failed state: the records that were lost
+// are never reported durable, and every later append(), sync() or flush()
+// rethrows the error. Retrying isn't safe once fsync has failed (the kernel
+// may already have dropped the dirty pages), so reopen the journal instead.
+
+#include "Command.hpp"
+#include "CommandHistory.hpp"
+#include "MappedFile.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class CommandJournal {
+public:
+  using RecordVisitor = std::function<void(std::uint16_t, DeltaReader&)>;
+
+  // Opens (or creates) the journal and cuts off any torn tail record.
+  // batchSize records trigger a group commit on their own; flush() or
+  // sync() commit earlier.
+  explicit CommandJournal(const std::string& path, std::size_t batchSize = 64);
+  ~CommandJournal();
+
+  CommandJournal(const CommandJournal&) = delete;
+  CommandJournal& operator=(const CommandJournal&) = delete;
+
+  // Buffers one record and returns its sequence number (1-based).
+  std::uint64_t append(
+      std::uint16_t type, const unsigned char* payload, std::size_t size);
+
+  // Blocks until the record with this sequence number is on disk. Concurrent
+  // callers share one fsync: whoever finds no commit in flight leads it.
+  void sync(std::uint64_t sequence);
+
+  void flush();
+
+  std::uint64_t durableSequence() const;
+  std::size_t commitCount() const;
+  const std::string& path() const { return path_; }
+
+  // Visits every valid record of a journal file in order and returns how
+  // many were visited.
+  static std::size_t replay(
+      const std::string& path, const RecordVisitor& visitor);
+
+private:
+  void commit(std::unique_lock<std::mutex>& lock);
+  void throwIfFailed() const;
+
+  std::string path_;
+  std::size_t batchSize_;
+  int fd_ = -1;
+  std::size_t durableOffset_ = 0;  // file size after the last good commit
+
+  mutable std::mutex mutex_;
+  std::condition_variable committed_;
+  std::vector<unsigned char> pending_;
+  std::vector<unsigned char> spare_;
+  std::size_t pendingRecords_ = 0;
+  std::uint64_t appendedSequence_ = 0;
+  std::uint64_t durableSequence_ = 0;
+  std::size_t commitCount_ = 0;
+  bool committing_ = false;
+  std::exception_ptr failure_;  // set once a commit has failed
+};
+
+// A Command that can be written to a CommandJournal. Concrete commands also
+// provide a static kType id and a static replay() taking the receiver and a
+// DeltaReader; see JournaledInvoker::registerCommand().
+class JournaledCommand : public Command {
+public:
+  virtual ~JournaledCommand() = default;
+  virtual std::uint16_t type() const = 0;
+  virtual void serialize(DeltaWriter& out) const = 0;
+};
+
+// Invoker that journals every command it executes.
+template<typename TReceiver>
+class JournaledInvoker {
+public:
+  using ReplayFunction = void (*)(TReceiver&, DeltaReader&);
+
+  JournaledInvoker(TReceiver& receiver, CommandJournal& journal) :
+      receiver_(receiver), journal_(journal) { }
+
+  template<typename TCommand>
+  void registerCommand() {
+    if (replayers_.size() <= TCommand::kType) {
+      replayers_.resize(TCommand::kType + 1u, nullptr);
+    }
+    replayers_[TCommand::kType] = &TCommand::replay;
+  }
+
+  void setCommand(JournaledCommand* command) { command_ = command; }
+
+  // Executes the current command and returns its journal sequence number;
+  // pass it to CommandJournal::sync() to wait for durability.
+  std::uint64_t executeCommand() {
+    command_->execute();
+    staging_.clear();
+    command_->serialize(staging_);
+    return journal_.append(command_->type(), staging_.data(), staging_.size());
+  }
+
+  // Rebuilds the receiver from the journal file. Call before executing new
+  // commands.
+  std::size_t recover() {
+    return CommandJournal::replay(
+        journal_.path(), [this](std::uint16_t type, DeltaReader& payload) {
+          if (type >= replayers_.size() || !replayers_[type]) {
+            throw std::runtime_error("journal record type is not registered");
+          }
+          replayers_[type](receiver_, payload);
+        });
+  }
+
+private:
+  TReceiver& receiver_;
+  CommandJournal& journal_;
+  JournaledCommand* command_ = nullptr;
+  std::vector<ReplayFunction> replayers_;
+  DeltaWriter staging_;
+};
+
+// Example receiver and commands: an account whose balance is rebuilt from
+// the journal of deposits and withdrawals.
+class Account {
+public:
+  void deposit(std::int64_t amount) { balance_ += amount; }
+  void withdraw(std::int64_t amount) { balance_ -= amount; }
+  std::int64_t balance() const { return balance_; }
+
+private:
+  std::int64_t balance_ = 0;
+};
+
+class DepositCommand : public JournaledCommand {
+public:
+  static constexpr std::uint16_t kType = 0;
+
+  DepositCommand(Account* account, std::int64_t amount) :
+      account_(account), amount_(amount) { }
+
+  void execute() override { account_->deposit(amount_); }
+  std::uint16_t type() const override { return kType; }
+  void serialize(DeltaWriter& out) const override { out.write(amount_); }
+
+  static void replay(Account& account, DeltaReader& payload) {
+    account.deposit(payload.read<std::int64_t>());
+  }
+
+private:
+  Account* account_;
+  std::int64_t amount_;
+};
+
+class WithdrawCommand : public JournaledCommand {
+public:
+  static constexpr std::uint16_t kType = 1;
+
+  WithdrawCommand(Account* account, std::int64_t amount) :
+      account_(account), amount_(amount) { }
+
+  void execute() override { account_->withdraw(amount_); }
+  std::uint16_t type() const override { return kType; }
+  void serialize(DeltaWriter& out) const override { out.write(amount_); }
+
+  static void replay(Account& account, DeltaReader& payload) {
+    account.withdraw(payload.read<std::int64_t>());
+  }
+
+private:
+  Account* account_;
+  std::int64_t amount_;
+};
+
+#endif
@@ -26,6 +26,8 @@ public:
     std::cout << "Composite " << name_ << " operation" << std::endl;
     for (auto child : children_) { child->operation(); }
   }
+  const std::string& name() const { return name_; }
+  const std::list<ComponentComposite*>& children() const { return children_; }
 
 private:
   std::string name_;
@@ -38,9 +40,10 @@ public:
   void operation() override {
     std::cout << "Leaf " << name_ << " operation" << std::endl;
   }
+  const std::string& name() const { return name_; }
 
 private:
   std::string name_;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1 @@
+#include "CopyOnWrite.hpp"
@@ -0,0 +1,94 @@
+#ifndef COPYONWRITE_H
+#define COPYONWRITE_H
+
+// Description:
+// Value wrapper whose copies share one reference-counted block until one of
+// them is written to. Copying a CopyOnWrite is a pointer copy and an atomic
+// increment. write() gives the caller a private copy of the state first if
+// the block is shared; a copy that is never written never copies the state.
+
+// Usage:
+// 1. objects with large state are copied often (prototype clones, snapshots)
+// and most copies are only read.
+// 2. copies may be read and released on other threads: the count is atomic,
+// and a block is only written in place when this wrapper is its sole owner.
+// A reference returned by write() must not be held across a copy of the
+// wrapper: the copy would share the block the reference writes to. A
+// moved-from wrapper may only be assigned to or destroyed.
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+template<typename TState>
+class CopyOnWrite {
+public:
+  explicit CopyOnWrite(TState state = TState()) :
+      block_(new Block{{1}, std::move(state)}) { }
+
+  CopyOnWrite(const CopyOnWrite& other) noexcept : block_(other.block_) {
+    block_->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  CopyOnWrite(CopyOnWrite&& other) noexcept :
+      block_(std::exchange(other.block_, nullptr)) { }
+
+  CopyOnWrite& operator=(const CopyOnWrite& other) noexcept {
+    if (block_ != other.block_) {
+      other.block_->refs.fetch_add(1, std::memory_order_relaxed);
+      release();
+      block_ = other.block_;
+    }
+    return *this;
+  }
+
+  CopyOnWrite& operator=(CopyOnWrite&& other) noexcept {
+    if (this != &other) {
+      release();
+      block_ = std::exchange(other.block_, nullptr);
+    }
+    return *this;
+  }
+
+  ~CopyOnWrite() { release(); }
+
+  const TState& read() const { return block_->state; }
+
+  // Copies the state first when another wrapper shares it.
+  TState& write() {
+    // acquire: pairs with the release of the last other owner, so its reads
+    // of the block happen before the writes made through the result.
+    if (block_->refs.load(std::memory_order_acquire) != 1) {
+      Block* copy = new Block{{1}, block_->state};
+      release();
+      block_ = copy;
+    }
+    return block_->state;
+  }
+
+  bool shared() const {
+    return block_->refs.load(std::memory_order_acquire) != 1;
+  }
+  bool sharesWith(const CopyOnWrite& other) const {
+    return block_ == other.block_;
+  }
+  std::size_t useCount() const {
+    return block_->refs.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Block {
+    std::atomic<std::size_t> refs;
+    TState state;
+  };
+
+  void release() noexcept {
+    if (block_ && block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete block_;
+    }
+  }
+
+  Block* block_;
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <memory>
+#include <utility>
 
 // Abstract class that defines the Operation interface.
 class Component {
@@ -51,4 +52,68 @@ public:
   }
 };
 
-#endif
\ No newline at end of file
+// Compile-time decorators. Each mixin derives from the layer it decorates and
+// calls it by qualified name, so the whole stack is one object and every
+// Operation() except the outermost is a direct, inlinable call.
+// Decorated<ConcreteComponent, ConcreteDecoratorMixinA,
+// ConcreteDecoratorMixinB> behaves like ConcreteDecoratorB wrapping
+// ConcreteDecoratorA wrapping ConcreteComponent, without the shared_ptrs.
+template<typename TBase>
+class ConcreteDecoratorMixinA : public TBase {
+public:
+  using TBase::TBase;
+  void Operation() const {
+    TBase::Operation();
+    std::cout << "ConcreteDecoratorA Operation" << std::endl;
+  }
+};
+
+template<typename TBase>
+class ConcreteDecoratorMixinB : public TBase {
+public:
+  using TBase::TBase;
+  void Operation() const {
+    TBase::Operation();
+    std::cout << "ConcreteDecoratorB Operation" << std::endl;
+  }
+};
+
+template<typename TComponent, template<typename> class... TDecorators>
+struct DecoratorStack {
+  using type = TComponent;
+};
+
+template<typename TComponent, template<typename> class TFirst,
+    template<typename> class... TRest>
+struct DecoratorStack<TComponent, TFirst, TRest...> {
+  using type = typename DecoratorStack<TFirst<TComponent>, TRest...>::type;
+};
+
+// The first decorator wraps the component, the last one is outermost. When
+// TComponent derives from Component, so does Decorated, and being final it
+// is still called directly when its static type is known.
+template<typename TComponent, template<typename> class... TDecorators>
+class Decorated final
+    : public DecoratorStack<TComponent, TDecorators...>::type {
+  using Base = typename DecoratorStack<TComponent, TDecorators...>::type;
+
+public:
+  using Base::Base;
+};
+
+// Puts any type with Operation() const behind the virtual Component
+// interface, e.g. a Decorated stack over a component that isn't a Component.
+template<typename T>
+class ComponentAdapter : public Component {
+public:
+  template<typename... TArgs>
+  explicit ComponentAdapter(TArgs&&... args) :
+      inner_(std::forward<TArgs>(args)...) { }
+  void Operation() const override { inner_.Operation(); }
+  const T& get() const { return inner_; }
+
+private:
+  T inner_;
+};
+
+#endif
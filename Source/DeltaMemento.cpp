@@ -0,0 +1,185 @@
+#include "DeltaMemento.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace {
+  const char kMagic[4] = {'D', 'P', 'M', 'S'};
+  const std::uint32_t kVersion = 1;
+  const std::size_t kFileHeaderSize =
+      sizeof(kMagic) + sizeof(kVersion) + sizeof(std::uint32_t);
+  const std::size_t kFrameHeaderSize = 1 + 2 * sizeof(std::uint32_t);
+
+  // Unchanged gaps shorter than this are folded into the surrounding run;
+  // a new run header would cost about as much as the bytes it skips.
+  const std::size_t kMinimumGap = 8;
+
+  void writeVarint(std::vector<unsigned char>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+      out.push_back(static_cast<unsigned char>(value | 0x80));
+      value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+  }
+
+  std::uint64_t readVarint(
+      const unsigned char*& cursor, const unsigned char* end) {
+    std::uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      if (cursor == end) { throw std::runtime_error("delta is truncated"); }
+      unsigned char byte = *cursor++;
+      value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) { return value; }
+    }
+    throw std::runtime_error("delta varint is too long");
+  }
+
+  std::uint32_t frameCrc(const unsigned char* data, std::size_t size) {
+    return static_cast<std::uint32_t>(
+        crc32(crc32(0L, Z_NULL, 0), data, static_cast<uInt>(size)));
+  }
+}  // namespace
+
+void encodeSnapshotDelta(const std::vector<unsigned char>& previous,
+    const std::vector<unsigned char>& current,
+    std::vector<unsigned char>& out) {
+  writeVarint(out, current.size());
+  const std::size_t common = std::min(previous.size(), current.size());
+  const std::size_t size = current.size();
+  std::size_t position = 0;
+  std::size_t runEnd = 0;  // end of the previously emitted run
+  while (position < size) {
+    // Skip equal bytes, a block at a time where possible.
+    while (position + 64 <= common &&
+           std::memcmp(&previous[position], &current[position], 64) == 0) {
+      position += 64;
+    }
+    while (position < common && previous[position] == current[position]) {
+      ++position;
+    }
+    if (position >= size) { break; }
+
+    std::size_t start = position;
+    std::size_t equal = 0;
+    while (position < size) {
+      if (position < common && previous[position] == current[position]) {
+        if (++equal == kMinimumGap) {
+          ++position;
+          break;
+        }
+      } else {
+        equal = 0;
+      }
+      ++position;
+    }
+    std::size_t end = position - equal;
+    writeVarint(out, start - runEnd);
+    writeVarint(out, end - start);
+    out.insert(out.end(), current.begin() + start, current.begin() + end);
+    runEnd = end;
+  }
+}
+
+void applySnapshotDelta(std::vector<unsigned char>& image,
+    const unsigned char* delta, std::size_t size) {
+  const unsigned char* cursor = delta;
+  const unsigned char* end = delta + size;
+  image.resize(static_cast<std::size_t>(readVarint(cursor, end)));
+  std::size_t position = 0;
+  while (cursor != end) {
+    position += static_cast<std::size_t>(readVarint(cursor, end));
+    std::size_t length = static_cast<std::size_t>(readVarint(cursor, end));
+    if (length > static_cast<std::size_t>(end - cursor) ||
+        position + length > image.size()) {
+      throw std::runtime_error("delta run is out of bounds");
+    }
+    std::memcpy(image.data() + position, cursor, length);
+    cursor += length;
+    position += length;
+  }
+}
+
+SnapshotLogWriter::SnapshotLogWriter(
+    const std::string& path, std::uint32_t keyframeInterval) :
+    buffer_(1 << 16), keyframeInterval_(keyframeInterval) {
+  out_.rdbuf()->pubsetbuf(buffer_.data(), buffer_.size());
+  out_.open(path, std::ios::binary | std::ios::trunc);
+  if (!out_) { throw std::runtime_error("cannot open " + path); }
+  out_.write(kMagic, sizeof(kMagic));
+  out_.write(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+  out_.write(reinterpret_cast<const char*>(&keyframeInterval_),
+      sizeof(keyframeInterval_));
+  bytesWritten_ = kFileHeaderSize;
+}
+
+void SnapshotLogWriter::append(
+    bool keyframe, const unsigned char* data, std::size_t size) {
+  unsigned char header[kFrameHeaderSize];
+  header[0] = keyframe ? 0 : 1;
+  std::uint32_t payloadSize = static_cast<std::uint32_t>(size);
+  std::uint32_t crc = frameCrc(data, size);
+  std::memcpy(header + 1, &payloadSize, sizeof(payloadSize));
+  std::memcpy(header + 1 + sizeof(payloadSize), &crc, sizeof(crc));
+  out_.write(reinterpret_cast<const char*>(header), sizeof(header));
+  out_.write(reinterpret_cast<const char*>(data),
+      static_cast<std::streamsize>(size));
+  if (!out_) { throw std::runtime_error("cannot write snapshot frame"); }
+  ++frameCount_;
+  bytesWritten_ += sizeof(header) + size;
+}
+
+void SnapshotLogWriter::flush() {
+  out_.flush();
+  if (!out_) { throw std::runtime_error("cannot flush snapshot log"); }
+}
+
+SnapshotLogReader::SnapshotLogReader(const std::string& path) : file_(path) {
+  const unsigned char* data = file_.data();
+  const std::size_t size = file_.size();
+  if (size < kFileHeaderSize || std::memcmp(data, kMagic, 4) != 0) {
+    throw std::runtime_error(path + " is not a snapshot log");
+  }
+  std::uint32_t version;
+  std::memcpy(&version, data + sizeof(kMagic), sizeof(version));
+  if (version != kVersion) {
+    throw std::runtime_error("unsupported snapshot log version");
+  }
+  std::memcpy(&keyframeInterval_, data + sizeof(kMagic) + sizeof(version),
+      sizeof(keyframeInterval_));
+
+  std::size_t offset = kFileHeaderSize;
+  while (size - offset >= kFrameHeaderSize) {
+    std::uint32_t payloadSize;
+    std::uint32_t crc;
+    std::memcpy(&payloadSize, data + offset + 1, sizeof(payloadSize));
+    std::memcpy(&crc, data + offset + 1 + sizeof(payloadSize), sizeof(crc));
+    std::size_t payload = offset + kFrameHeaderSize;
+    if (size - payload < payloadSize ||
+        frameCrc(data + payload, payloadSize) != crc) {
+      break;
+    }
+    frames_.push_back(Frame{payload, payloadSize, data[offset] == 0});
+    offset = payload + payloadSize;
+  }
+}
+
+void SnapshotLogReader::reconstruct(
+    std::size_t index, std::vector<unsigned char>& image) const {
+  if (index >= frames_.size()) {
+    throw std::out_of_range("snapshot index out of range");
+  }
+  std::size_t keyframe = index;
+  while (!frames_[keyframe].keyframe) {
+    if (keyframe == 0) {
+      throw std::runtime_error("snapshot log has no keyframe");
+    }
+    --keyframe;
+  }
+  const Frame& key = frames_[keyframe];
+  image.assign(file_.data() + key.offset, file_.data() + key.offset + key.size);
+  for (std::size_t i = keyframe + 1; i <= index; ++i) {
+    applySnapshotDelta(
+        image, file_.data() + frames_[i].offset, frames_[i].size);
+  }
+}
@@ -0,0 +1,188 @@
+#ifndef DELTAMEMENTO_H
+#define DELTAMEMENTO_H
+
+// Description:
+// Memento history streamed to a file as binary deltas. Every snapshot of the
+// originator's state is encoded into a byte image; the caretaker writes the
+// difference to the previous image, and a full keyframe every K snapshots.
+// Restoring snapshot n decodes the nearest keyframe at or before n and applies
+// the deltas that follow it, so restore cost is bounded by K.
+
+// Usage:
+// 1. history must outlive the process or be too long to keep in memory.
+// 2. consecutive states differ in few bytes (counters, edited cells).
+// 3. you can trade restore latency (larger K) against file size.
+
+// File format (host byte order):
+//   header : "DPMS" u32 version, u32 keyframeInterval
+//   frame  : u8 kind (0 keyframe, 1 delta), u32 payloadSize, u32 crc32,
+//            payload
+//   delta  : varint newSize, then runs of (varint skip, varint length, bytes)
+// Varints are LEB128; skip counts unchanged bytes since the previous run.
+
+#include "MappedFile.hpp"
+#include "PersistentVector.hpp"
+#include "VersionedMemento.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Encodes a state into a byte image and back. Specialize for your own state
+// types.
+template<typename TState, typename = void>
+struct SnapshotCodec;
+
+template<typename TState>
+struct SnapshotCodec<TState,
+    std::enable_if_t<std::is_trivially_copyable<TState>::value>> {
+  static void encode(const TState& state, std::vector<unsigned char>& out) {
+    out.resize(sizeof(TState));
+    std::memcpy(out.data(), &state, sizeof(TState));
+  }
+  static TState decode(const std::vector<unsigned char>& image) {
+    TState state;
+    std::memcpy(&state, image.data(), sizeof(TState));
+    return state;
+  }
+};
+
+template<typename T>
+struct SnapshotCodec<std::vector<T>,
+    std::enable_if_t<std::is_trivially_copyable<T>::value>> {
+  static void encode(
+      const std::vector<T>& state, std::vector<unsigned char>& out) {
+    out.resize(state.size() * sizeof(T));
+    if (!state.empty()) {
+      std::memcpy(out.data(), state.data(), out.size());
+    }
+  }
+  static std::vector<T> decode(const std::vector<unsigned char>& image) {
+    std::vector<T> state(image.size() / sizeof(T));
+    if (!state.empty()) {
+      std::memcpy(state.data(), image.data(), state.size() * sizeof(T));
+    }
+    return state;
+  }
+};
+
+template<typename T>
+struct SnapshotCodec<PersistentVector<T>,
+    std::enable_if_t<std::is_trivially_copyable<T>::value>> {
+  static void encode(
+      const PersistentVector<T>& state, std::vector<unsigned char>& out) {
+    out.resize(state.size() * sizeof(T));
+    for (std::size_t i = 0; i < state.size(); ++i) {
+      std::memcpy(out.data() + i * sizeof(T), &state[i], sizeof(T));
+    }
+  }
+  static PersistentVector<T> decode(const std::vector<unsigned char>& image) {
+    PersistentVector<T> state;
+    for (std::size_t i = 0; i + sizeof(T) <= image.size(); i += sizeof(T)) {
+      T value;
+      std::memcpy(&value, image.data() + i, sizeof(T));
+      state.push_back(value);
+    }
+    return state;
+  }
+};
+
+// Appends to out the delta turning previous into current.
+void encodeSnapshotDelta(const std::vector<unsigned char>& previous,
+    const std::vector<unsigned char>& current,
+    std::vector<unsigned char>& out);
+
+// Applies a delta produced by encodeSnapshotDelta() to image in place.
+void applySnapshotDelta(std::vector<unsigned char>& image,
+    const unsigned char* delta, std::size_t size);
+
+// Streams frames to a new snapshot file.
+class SnapshotLogWriter {
+public:
+  SnapshotLogWriter(const std::string& path, std::uint32_t keyframeInterval);
+
+  void append(bool keyframe, const unsigned char* data, std::size_t size);
+  void flush();
+
+  std::uint32_t keyframeInterval() const { return keyframeInterval_; }
+  std::size_t frameCount() const { return frameCount_; }
+  std::uint64_t bytesWritten() const { return bytesWritten_; }
+
+private:
+  std::ofstream out_;
+  std::vector<char> buffer_;
+  std::uint32_t keyframeInterval_;
+  std::size_t frameCount_ = 0;
+  std::uint64_t bytesWritten_ = 0;
+};
+
+// Maps a snapshot file and rebuilds any snapshot in it. Reading stops at the
+// first torn or corrupt frame.
+class SnapshotLogReader {
+public:
+  explicit SnapshotLogReader(const std::string& path);
+
+  std::size_t frameCount() const { return frames_.size(); }
+  std::uint32_t keyframeInterval() const { return keyframeInterval_; }
+
+  void reconstruct(std::size_t index, std::vector<unsigned char>& image) const;
+
+private:
+  struct Frame {
+    std::size_t offset;  // of the payload
+    std::uint32_t size;
+    bool keyframe;
+  };
+
+  MappedFile file_;
+  std::vector<Frame> frames_;
+  std::uint32_t keyframeInterval_ = 0;
+};
+
+template<typename TState>
+class DeltaCaretaker {
+public:
+  DeltaCaretaker(VersionedOriginator<TState>* originator,
+      const std::string& path, std::uint32_t keyframeInterval = 32) :
+      originator_(originator), path_(path),
+      writer_(path, keyframeInterval ? keyframeInterval : 1) { }
+
+  // Returns the index of the snapshot.
+  std::size_t saveState() {
+    SnapshotCodec<TState>::encode(originator_->state(), current_);
+    std::size_t index = writer_.frameCount();
+    if (index % writer_.keyframeInterval() == 0) {
+      writer_.append(true, current_.data(), current_.size());
+    } else {
+      delta_.clear();
+      encodeSnapshotDelta(previous_, current_, delta_);
+      writer_.append(false, delta_.data(), delta_.size());
+    }
+    previous_.swap(current_);
+    return index;
+  }
+
+  void restoreState(std::size_t index) {
+    writer_.flush();
+    SnapshotLogReader reader(path_);
+    reader.reconstruct(index, current_);
+    originator_->state() = SnapshotCodec<TState>::decode(current_);
+  }
+
+  std::size_t size() const { return writer_.frameCount(); }
+  std::uint64_t bytesWritten() const { return writer_.bytesWritten(); }
+
+private:
+  VersionedOriginator<TState>* originator_;
+  std::string path_;
+  SnapshotLogWriter writer_;
+  std::vector<unsigned char> previous_;
+  std::vector<unsigned char> current_;
+  std::vector<unsigned char> delta_;
+};
+
+#endif
@@ -1,7 +1,14 @@
 #include "DesignPatternsCppLib/DesignPatternsCppLib.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <thread>
+#include <vector>
 #include <designpatternscpplib/version.h>
 
 #include <IoCDependencyInjectionLog.hpp>
@@ -21,24 +28,43 @@
 #include <Controller.hpp>
 
 #include <Command.hpp>
+#include <CommandExecutor.hpp>
+#include <CommandHistory.hpp>
+#include <CommandJournal.hpp>
 #include <ChainOfResponsibility.hpp>
+#include <InstrumentedChain.hpp>
 #include <Iterator.hpp>
 #include <Mediator.hpp>
+#include <MessageBus.hpp>
 #include <Interpreter.hpp>
 #include <Memento.hpp>
+#include <VersionedMemento.hpp>
+#include <DeltaMemento.hpp>
+#include <AsyncMemento.hpp>
 #include <State.hpp>
+#include <TransitionTable.hpp>
 #include <TemplateMethod.hpp>
 #include <Strategy.hpp>
+#include <StrategyRegistry.hpp>
+#include <AutoTuningContext.hpp>
 #include <Observer.hpp>
 #include <Bridge.hpp>
 #include <Composite.hpp>
+#include <FlatComposite.hpp>
+#include <AggregateComposite.hpp>
 #include <Flyweight.hpp>
 #include <Decorator.hpp>
+#include <InstrumentedDecorator.hpp>
 #include <Proxy.hpp>
+#include <CachingProxy.hpp>
+#include <BatchingProxy.hpp>
+#include <VirtualProxy.hpp>
 #include <Facade.hpp>
 #include <Wrapper.hpp>
 #include <Builder.hpp>
+#include <ParallelDirector.hpp>
 #include <Prototype.hpp>
+#include <PrototypeRegistry.hpp>
 #include <Singleton.hpp>
 #include <FactoryMethod.hpp>
 
@@ -155,6 +181,78 @@ DesignPatternsCppLib::DesignPatternsCppLib() {
   invoker.setCommand(&concreteCommand);
   invoker.executeCommand();
 
+  // Command executor
+  {
+    CommandExecutor executor(2);
+    executor.submit(&concreteCommand);
+    std::atomic<int> executed{0};
+    std::atomic<int> completed{0};
+    for (int i = 0; i < 100; ++i) {
+      executor.submit(
+          [&executed] { ++executed; }, [&completed] { ++completed; });
+    }
+    std::future<void> done =
+        executor.submitWithFuture([&executed] { ++executed; });
+    done.wait();
+    executor.wait();
+    std::cout << "CommandExecutor executed: " << executed.load()
+              << " completed callbacks: " << completed.load() << std::endl;
+  }  // Command executor
+
+  // Command history (undo / redo)
+  {
+    TextDocument document;
+    CommandHistory<TextDocument> history(document);
+    history.registerCommand<InsertTextCommand>();
+    history.registerCommand<EraseTextCommand>();
+    for (const char* key : {"H", "e", "l", "l", "o"}) {
+      InsertTextCommand typing(&document, document.text().size(), key);
+      history.execute(typing);  // merged into one undo step
+    }
+    EraseTextCommand erase(&document, 1, 3);
+    history.execute(erase);
+    std::cout << "CommandHistory text: " << document.text() << std::endl;
+    history.undo();
+    std::cout << "CommandHistory undo: " << document.text() << std::endl;
+    history.undo();
+    std::cout << "CommandHistory undo: '" << document.text() << "'"
+              << std::endl;
+    history.redo();
+    std::cout << "CommandHistory redo: " << document.text() << std::endl;
+  }  // Command history
+
+  // Command journal
+  {
+    std::string journalPath =
+        (std::filesystem::temp_directory_path() / "DesignPatternsCpp.journal")
+            .string();
+    std::filesystem::remove(journalPath);
+    {
+      Account account;
+      CommandJournal journal(journalPath, 16);
+      JournaledInvoker<Account> journaledInvoker(account, journal);
+      DepositCommand deposit(&account, 100);
+      WithdrawCommand withdraw(&account, 30);
+      journaledInvoker.setCommand(&deposit);
+      journaledInvoker.executeCommand();
+      journaledInvoker.setCommand(&withdraw);
+      journal.sync(journaledInvoker.executeCommand());
+      std::cout << "CommandJournal balance: " << account.balance()
+                << std::endl;
+    }
+    {
+      Account account;
+      CommandJournal journal(journalPath);
+      JournaledInvoker<Account> journaledInvoker(account, journal);
+      journaledInvoker.registerCommand<DepositCommand>();
+      journaledInvoker.registerCommand<WithdrawCommand>();
+      std::size_t replayed = journaledInvoker.recover();
+      std::cout << "CommandJournal replayed " << replayed
+                << " commands, balance: " << account.balance() << std::endl;
+    }
+    std::filesystem::remove(journalPath);
+  }  // Command journal
+
   // Chain of Responsibility
   ConcreteChainA concreteChainA;
   ConcreteChainB concreteChainB;
@@ -165,6 +263,28 @@ DesignPatternsCppLib::DesignPatternsCppLib() {
   concreteChainA.handle(0);
   concreteChainA.handle(1);
 
+  // Chain of Responsibility composed at compile time
+  StaticChain<NegativeRequestHandler, ZeroRequestHandler,
+      PositiveRequestHandler, UnhandledRequestHandler>
+      staticChain;
+  staticChain.handle(-1);
+  staticChain.handle(0);
+  staticChain.handle(1);
+
+  // Chain of Responsibility with metrics and adaptive reordering
+  InstrumentedChain instrumentedChain;
+  instrumentedChain.add("negative", NegativeRequestHandler());
+  instrumentedChain.add("zero", ZeroRequestHandler());
+  instrumentedChain.add("positive", PositiveRequestHandler());
+  instrumentedChain.add("unhandled", UnhandledRequestHandler());
+  instrumentedChain.setAdaptive(true, 4);
+  for (int request : {5, 7, -1, 3, 9, 0, 4, 8}) {
+    instrumentedChain.handle(request);
+  }
+  std::cout << "InstrumentedChain average hops: "
+            << instrumentedChain.averageHops() << std::endl;
+  instrumentedChain.exportMetrics(std::cout);
+
   // Iterator / Enumerator
   int array[] = {1, 2, 3, 4, 5};
   ConcreteIterator concreteIterator(array, sizeof(array) / sizeof(array[0]));
@@ -182,6 +302,41 @@ DesignPatternsCppLib::DesignPatternsCppLib() {
   concreteColleagueA.notify(1);
   concreteColleagueB.notify(2);
 
+  // Mediator as a topic-based message bus
+  {
+    const std::uint32_t priceTopic = 0;
+    const std::uint32_t orderTopic = 1;
+    MessageBus messageBus(2);
+    BusColleague& pricer = messageBus.join();
+    BusColleague& trader = messageBus.join();
+    pricer.advertise(priceTopic);
+    trader.subscribe(priceTopic);
+    trader.advertise(orderTopic);
+    pricer.subscribe(orderTopic);
+    messageBus.seal();
+
+    std::thread pricerThread([&pricer] {
+      for (int tick = 1; tick <= 100; ++tick) {
+        pricer.publish(priceTopic, 100.0 + tick);
+      }
+    });
+    double lastPrice = 0.0;
+    int prices = 0;
+    while (prices < 100) {
+      prices += static_cast<int>(trader.poll([&](const BusMessage& message) {
+        lastPrice = message.as<double>();
+      }));
+    }
+    pricerThread.join();
+    trader.publish(orderTopic, 42);
+    pricer.poll([](const BusMessage& message) {
+      std::cout << "MessageBus order from colleague " << message.sender
+                << ": " << message.as<int>() << std::endl;
+    });
+    std::cout << "MessageBus delivered " << prices
+              << " prices, last " << lastPrice << std::endl;
+  }
+
   // Interpreter terminal expression
   InterpreterContext interpreterContext("add");
   AbstractExpression* abstractExpression = new TerminalExpression();
@@ -207,6 +362,67 @@ DesignPatternsCppLib::DesignPatternsCppLib() {
   caretaker.restoreState();
   std::cout << "Restored State: " << originator.getState() << std::endl;
 
+  // Memento with many versions sharing unchanged data
+  {
+    VersionedOriginator<PersistentVector<int>> versionedOriginator(
+        PersistentVector<int>(100000, 0));
+    VersionedCaretaker<PersistentVector<int>> versionedCaretaker(
+        &versionedOriginator, 100);
+    for (int i = 1; i <= 10; ++i) {
+      versionedOriginator.state().set(i * 1000, i);
+      versionedCaretaker.saveState();
+    }
+    versionedCaretaker.restoreState(3);
+    std::cout << "VersionedMemento version 3: cell 4000 = "
+              << versionedOriginator.state()[4000]
+              << ", cell 10000 = " << versionedOriginator.state()[10000]
+              << std::endl;
+  }
+
+  // Memento history streamed as deltas with periodic keyframes
+  {
+    std::string snapshotPath =
+        (std::filesystem::temp_directory_path() / "DesignPatternsCpp.snapshots")
+            .string();
+    VersionedOriginator<std::vector<int>> deltaOriginator(
+        std::vector<int>(10000, 0));
+    {
+      DeltaCaretaker<std::vector<int>> deltaCaretaker(
+          &deltaOriginator, snapshotPath, 4);
+      for (int i = 0; i < 10; ++i) {
+        deltaOriginator.state()[static_cast<std::size_t>(i) * 100] = i + 1;
+        deltaCaretaker.saveState();
+      }
+      deltaCaretaker.restoreState(5);
+      std::cout << "DeltaMemento snapshot 5: cell 500 = "
+                << deltaOriginator.state()[500]
+                << ", cell 600 = " << deltaOriginator.state()[600]
+                << ", file bytes: " << deltaCaretaker.bytesWritten()
+                << std::endl;
+    }
+    std::filesystem::remove(snapshotPath);
+  }
+
+  // Memento checkpoints compressed in the background
+  {
+    VersionedOriginator<PersistentVector<int>> asyncOriginator(
+        PersistentVector<int>(100000, 7));
+    AsyncCaretaker<PersistentVector<int>> asyncCaretaker(&asyncOriginator);
+    std::uint64_t first = asyncCaretaker.saveState();
+    for (std::size_t i = 0; i < 1000; ++i) {
+      asyncOriginator.state().set(i, 0);
+    }
+    asyncCaretaker.saveState();
+    asyncCaretaker.restoreState(first);
+    asyncCaretaker.wait();
+    CheckpointPauses pauses = asyncCaretaker.pauses();
+    std::cout << "AsyncCaretaker restored cell 0 = "
+              << asyncOriginator.state()[0] << ", " << pauses.count
+              << " checkpoints, max pause " << pauses.max.count() << " ns, "
+              << asyncCaretaker.compressedBytes() << " compressed bytes"
+              << std::endl;
+  }
+
   // State
   ContextState* contextState = new ContextState(new ConcreteStateA());
   contextState->request();
@@ -214,6 +430,69 @@ DesignPatternsCppLib::DesignPatternsCppLib() {
   contextState->request();
   delete contextState;
 
+  // State held inline, no allocation per transition
+  VariantContextState<ConcreteStateA, ConcreteStateB> variantContextState{
+      ConcreteStateA()};
+  variantContextState.request();
+  variantContextState.setState<ConcreteStateB>();
+  variantContextState.request();
+
+  // State machine declared as a transition table
+  {
+    enum class SessionState { Idle, Open, Closed, Count };
+    enum class SessionEvent { Connect, Data, Disconnect, Count };
+    struct Session {
+      int packets = 0;
+    };
+    using Row = Transition<SessionState, SessionEvent, Session>;
+    using Queue = EventQueue<SessionEvent>;
+    static constexpr Row rows[] = {
+        {SessionState::Idle, SessionEvent::Connect, SessionState::Open,
+            nullptr},
+        {SessionState::Idle, SessionEvent::Data, SessionState::Idle, nullptr},
+        {SessionState::Idle, SessionEvent::Disconnect, SessionState::Closed,
+            nullptr},
+        {SessionState::Open, SessionEvent::Connect, SessionState::Open,
+            nullptr},
+        {SessionState::Open, SessionEvent::Data, SessionState::Open,
+            [](Session& session, Queue& queue) {
+              if (++session.packets == 3) {
+                queue.post(SessionEvent::Disconnect);
+              }
+            }},
+        {SessionState::Open, SessionEvent::Disconnect, SessionState::Closed,
+            nullptr},
+        {SessionState::Closed, SessionEvent::Connect, SessionState::Closed,
+            nullptr},
+        {SessionState::Closed, SessionEvent::Data, SessionState::Closed,
+            nullptr},
+        {SessionState::Closed, SessionEvent::Disconnect, SessionState::Closed,
+            nullptr},
+    };
+    static constexpr TransitionTable<SessionState, SessionEvent, Session>
+        sessionTable(rows);
+
+    TableStateMachine<SessionState, SessionEvent, Session> session(
+        sessionTable, SessionState::Idle);
+    session.post(SessionEvent::Connect);
+    for (int i = 0; i < 5; ++i) { session.post(SessionEvent::Data); }
+    std::cout << "TableStateMachine closed after "
+              << session.context().packets << " packets: "
+              << (session.state() == SessionState::Closed) << std::endl;
+
+    TableStateMachineBatch<SessionState, SessionEvent, Session> sessions(
+        sessionTable);
+    sessions.reserve(100000);
+    for (int i = 0; i < 100000; ++i) { sessions.add(SessionState::Idle); }
+    sessions.dispatch(SessionEvent::Connect);
+    sessions.dispatch(SessionEvent::Data);
+    sessions.dispatch(std::size_t(7), SessionEvent::Disconnect);
+    std::cout << "TableStateMachineBatch instance 7 closed: "
+              << (sessions.state(7) == SessionState::Closed)
+              << ", instance 8 packets: " << sessions.context(8).packets
+              << std::endl;
+  }
+
   // Template Method
   ConcreteTemplateMethodA concreteTemplateMethodA;
   concreteTemplateMethodA.templateMethod();
@@ -228,6 +507,50 @@ DesignPatternsCppLib::DesignPatternsCppLib() {
   context->contextInterface();
   delete context;
 
+  // Strategy fixed at compile time
+  StaticContext<ConcreteStrategyA> staticContext;
+  staticContext.contextInterface();
+
+  // Strategies selected by name and swapped at runtime
+  {
+    StrategyRegistry strategyRegistry;
+    strategyRegistry.add("A", std::make_unique<ConcreteStrategyA>());
+    strategyRegistry.add("B", std::make_unique<ConcreteStrategyB>());
+    HotSwapContext hotSwapContext(strategyRegistry, "A");
+    hotSwapContext.contextInterface();
+    hotSwapContext.select("B");
+    hotSwapContext.contextInterface();
+  }
+
+  // Strategy chosen by timing the candidates per input size
+  {
+    AutoTuningContext<std::vector<int>> tuningContext(3, 1000);
+    tuningContext.add("insertion_sort", [](std::vector<int>& values) {
+      for (std::size_t i = 1; i < values.size(); ++i) {
+        int value = values[i];
+        std::size_t j = i;
+        for (; j > 0 && values[j - 1] > value; --j) {
+          values[j] = values[j - 1];
+        }
+        values[j] = value;
+      }
+    });
+    tuningContext.add("std_sort", [](std::vector<int>& values) {
+      std::sort(values.begin(), values.end());
+    });
+    for (std::size_t size : {std::size_t(8), std::size_t(2048)}) {
+      for (int call = 0; call < 20; ++call) {
+        std::vector<int> values(size);
+        for (std::size_t i = 0; i < size; ++i) {
+          values[i] = static_cast<int>((i * 7919 + call) % size);
+        }
+        tuningContext.contextInterface(values);
+      }
+    }
+    std::cout << "AutoTuningContext picked " << tuningContext.choiceFor(2048)
+              << " for 2048 elements" << std::endl;
+  }
+
   // Observer
   ConcreteSubject* concreteSubject = new ConcreteSubject();
   Observer* observerA = new ConcreteObserverA();
@@ -266,6 +589,50 @@ DesignPatternsCppLib::DesignPatternsCppLib() {
   branch1->add(leaf2);
   branch2->add(leaf3);
   root->operation();
+
+  // Composite stored flat in pre-order
+  {
+    FlatComposite flatComposite = FlatComposite::fromTree(*root);
+    flatComposite.operation();
+    auto rebuiltTree = flatComposite.toTree();
+    std::cout << "FlatComposite rebuilt " << rebuiltTree.size() << " nodes"
+              << std::endl;
+
+    FlatComposite forest;
+    forest.reserve(1 + 1000 * 101);
+    forest.beginComposite("forest");
+    for (int tree = 0; tree < 1000; ++tree) {
+      forest.beginComposite("tree");
+      for (int leaf = 0; leaf < 100; ++leaf) { forest.addLeaf("leaf"); }
+      forest.endComposite();
+    }
+    forest.endComposite();
+    std::atomic<std::size_t> forestLeaves{0};
+    forest.parallelForEach(0, [&](std::uint32_t node) {
+      if (forest.isLeaf(node)) {
+        forestLeaves.fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+    std::cout << "FlatComposite counted " << forestLeaves.load() << " leaves"
+              << std::endl;
+  }
+
+  // Composite caching subtree totals
+  {
+    AggregateComposite<long> disk("disk");
+    AggregateComposite<long> home("home");
+    AggregateLeaf<long> notes("notes.txt", 120);
+    AggregateLeaf<long> photo("photo.jpg", 4000);
+    AggregateLeaf<long> kernel("kernel", 9000);
+    disk.add(&home);
+    disk.add(&kernel);
+    home.add(&notes);
+    home.add(&photo);
+    std::cout << "AggregateComposite total " << disk.aggregate();
+    notes.setValue(180);
+    std::cout << ", after editing notes.txt " << disk.aggregate()
+              << std::endl;
+  }
   delete root;
   delete branch1;
   delete branch2;
@@ -291,11 +658,85 @@ DesignPatternsCppLib::DesignPatternsCppLib() {
       std::make_shared<ConcreteDecoratorB>(decoratorA);
   decoratorB->Operation();
 
+  // Decorators stacked at compile time
+  Decorated<ConcreteComponent, ConcreteDecoratorMixinA, ConcreteDecoratorMixinB>
+      decoratedComponent;
+  decoratedComponent.Operation();
+  std::shared_ptr<Component> decoratedAsComponent = std::make_shared<
+      Decorated<ConcreteComponent, ConcreteDecoratorMixinA>>();
+  decoratedAsComponent->Operation();
+
+  // Decorators profiling a component
+  {
+    std::shared_ptr<Component> profiled = std::make_shared<TimingDecorator>(
+        std::make_shared<ConcreteComponent>(), "component.latency");
+    profiled = std::make_shared<CountingDecorator>(profiled, "component.calls");
+    profiled =
+        std::make_shared<SamplingDecorator>(profiled, "component.trace", 2);
+    for (int i = 0; i < 3; ++i) { profiled->Operation(); }
+    InstrumentationRegistry::getInstance().writeText(std::cout);
+  }
+
   // Proxy
   std::shared_ptr<RealSubject> real_subject = std::make_shared<RealSubject>();
   Proxy proxy(real_subject);
   proxy.Request();
 
+  // Proxy caching a keyed subject
+  {
+    std::atomic<int> subjectCalls{0};
+    CachingProxy<int, long> cachingProxy(
+        [&subjectCalls](const int& n) {
+          ++subjectCalls;
+          long result = 1;
+          for (int i = 2; i <= n; ++i) { result *= i; }
+          return result;
+        },
+        1 << 20, std::chrono::seconds(60));
+    std::vector<std::future<long>> requests;
+    for (int i = 0; i < 8; ++i) {
+      requests.push_back(std::async(std::launch::async,
+          [&cachingProxy] { return cachingProxy.Request(10); }));
+    }
+    for (auto& request : requests) { request.get(); }
+    std::cout << "CachingProxy 10! = " << cachingProxy.Request(10) << " after "
+              << subjectCalls.load() << " subject call(s), "
+              << cachingProxy.stats().hits << " hit(s)" << std::endl;
+  }
+
+  // Proxy batching single requests into bulk calls
+  {
+    BatchingProxy<int, int> batchingProxy(
+        [](const std::vector<int>& values) {
+          std::vector<int> squares;
+          squares.reserve(values.size());
+          for (int value : values) { squares.push_back(value * value); }
+          return squares;
+        },
+        16, std::chrono::milliseconds(2));
+    std::vector<std::future<int>> squares;
+    for (int i = 0; i < 100; ++i) {
+      squares.push_back(batchingProxy.Request(i));
+    }
+    batchingProxy.flush();
+    int sum = 0;
+    for (auto& square : squares) { sum += square.get(); }
+    std::cout << "BatchingProxy summed " << squares.size() << " squares to "
+              << sum << " in " << batchingProxy.batchCount() << " batches"
+              << std::endl;
+  }
+
+  // Proxy constructing its subject on first use
+  {
+    VirtualProxy<RealSubject> virtualProxy;
+    std::cout << "VirtualProxy constructed before use: "
+              << virtualProxy.constructed() << std::endl;
+    virtualProxy.prefetch();
+    virtualProxy.Request();
+    std::cout << "VirtualProxy constructed after use: "
+              << virtualProxy.constructed() << std::endl;
+  }
+
   // Facade
   Facade* facade = new Facade();
   facade->operation();
@@ -317,13 +758,70 @@ DesignPatternsCppLib::DesignPatternsCppLib() {
   delete director;
   delete concreteBuilder;
 
+  // Fluent Builder moving its Product out
+  Product fluentProduct =
+      FluentBuilder().partA("Part A").partB("Part B").partC("Part C").build();
+  fluentProduct.show();
+  FluentBuilder fluentBuilder;
+  fluentBuilder.partA("Part A").partB("Part B");
+  fluentBuilder.partC(std::string(40, 'C'));
+  std::move(fluentBuilder).build().show();
+
+  // Parallel Director: parts 1-3 run concurrently, the check waits for all
+  {
+    CommandExecutor executor(2);
+    ConcreteBuilder parallelBuilder;
+    ParallelDirector parallelDirector(executor);
+    parallelDirector.setBuilder(&parallelBuilder);
+    std::size_t part1 = parallelDirector.addBuilderParts();
+    parallelDirector.addStep("check",
+        [](Builder& builder) { builder.getProduct().show(); },
+        {part1, part1 + 1, part1 + 2});
+    parallelDirector.construct();
+    std::cout << "ParallelDirector ran " << parallelDirector.stepCount()
+              << " steps" << std::endl;
+  }
+
   // Prototype/Clone
   Prototype* prototype = new ConcretePrototype1();
   std::unique_ptr<Prototype> clone = prototype->clone();
   prototype->print();
   clone->print();
+
+  // Bulk cloning into one contiguous buffer
+  {
+    PrototypeBatch batch = prototype->cloneN(10000, 2);
+    batch[0].print();
+    std::cout << "PrototypeBatch clones: " << batch.size() << std::endl;
+  }
+
+  // Copy-on-write clones sharing the prototype's state until written
+  {
+    CowPrototype cowPrototype("large", std::vector<double>(100000, 1.0));
+    std::unique_ptr<Prototype> cowClone = cowPrototype.clone();
+    cowClone->print();
+    CowPrototype written(cowPrototype);
+    written.setValue(0, 2.0);
+    written.print();
+    std::cout << "CowPrototype written clone shares state: "
+              << (written.sharesStateWith(cowPrototype) ? "yes" : "no")
+              << std::endl;
+  }
   delete prototype;
 
+  // Prototype registry handing out silent, pre-made clones
+  {
+    PrototypeRegistry registry(8);
+    registry.add("first", std::make_unique<ConcretePrototype1>());
+    registry.add("second", std::make_unique<ConcretePrototype2>());
+    PrototypeRegistry::Clone pooled = registry.clone("first");
+    pooled->print();
+    registry.clone("second")->print();
+    PrototypeRegistryStats registryStats = registry.stats("first");
+    std::cout << "PrototypeRegistry hits: " << registryStats.hits
+              << " misses: " << registryStats.misses << std::endl;
+  }
+
   // Singleton - anti-pattern
   Singleton& singleton = Singleton::getInstance();
   singleton.print();
@@ -0,0 +1,99 @@
+#include "FlatComposite.hpp"
+
+#include <iostream>
+#include <utility>
+
+FlatComposite FlatComposite::fromTree(const ComponentComposite& root) {
+  FlatComposite flat;
+  // Explicit stack instead of recursion; deep trees would overflow the call
+  // stack. A null entry closes the composite opened before its children.
+  std::vector<const ComponentComposite*> pending{&root};
+  while (!pending.empty()) {
+    const ComponentComposite* node = pending.back();
+    pending.pop_back();
+    if (!node) {
+      flat.endComposite();
+    } else if (auto leaf = dynamic_cast<const Leaf*>(node)) {
+      flat.addLeaf(leaf->name());
+    } else if (auto composite = dynamic_cast<const Composite*>(node)) {
+      flat.beginComposite(composite->name());
+      pending.push_back(nullptr);
+      const auto& children = composite->children();
+      for (auto it = children.rbegin(); it != children.rend(); ++it) {
+        pending.push_back(*it);
+      }
+    } else {
+      throw std::invalid_argument(
+          "FlatComposite only converts Composite and Leaf nodes");
+    }
+  }
+  return flat;
+}
+
+std::vector<std::unique_ptr<ComponentComposite>> FlatComposite::toTree()
+    const {
+  if (!open_.empty()) {
+    throw std::logic_error("FlatComposite has an unfinished composite");
+  }
+  std::vector<std::unique_ptr<ComponentComposite>> nodes;
+  nodes.reserve(size());
+  for (std::uint32_t i = 0; i < size(); ++i) {
+    if (isLeaf(i)) {
+      nodes.emplace_back(new Leaf(names_[i]));
+    } else {
+      nodes.emplace_back(new Composite(names_[i]));
+    }
+    if (parents_[i] != kNoParent) {
+      nodes[parents_[i]]->add(nodes[i].get());
+    }
+  }
+  return nodes;
+}
+
+std::uint32_t FlatComposite::beginComposite(std::string name) {
+  std::uint32_t node = append(std::move(name), false);
+  open_.push_back(node);
+  return node;
+}
+
+std::uint32_t FlatComposite::addLeaf(std::string name) {
+  return append(std::move(name), true);
+}
+
+void FlatComposite::endComposite() {
+  if (open_.empty()) {
+    throw std::logic_error("endComposite() without beginComposite()");
+  }
+  ends_[open_.back()] = static_cast<std::uint32_t>(size());
+  open_.pop_back();
+}
+
+void FlatComposite::reserve(std::size_t nodes) {
+  names_.reserve(nodes);
+  leaf_.reserve(nodes);
+  parents_.reserve(nodes);
+  ends_.reserve(nodes);
+}
+
+void FlatComposite::operation() const {
+  if (!open_.empty()) {
+    throw std::logic_error("FlatComposite has an unfinished composite");
+  }
+  for (std::uint32_t i = 0; i < size(); ++i) {
+    std::cout << (isLeaf(i) ? "Leaf " : "Composite ") << names_[i]
+              << " operation" << std::endl;
+  }
+}
+
+// Until its composite is ended, a node's subtree end is provisional.
+std::uint32_t FlatComposite::append(std::string name, bool leaf) {
+  if (size() >= kNoParent) {
+    throw std::length_error("FlatComposite is full");
+  }
+  std::uint32_t node = static_cast<std::uint32_t>(size());
+  names_.push_back(std::move(name));
+  leaf_.push_back(leaf ? 1 : 0);
+  parents_.push_back(open_.empty() ? kNoParent : open_.back());
+  ends_.push_back(node + 1);
+  return node;
+}
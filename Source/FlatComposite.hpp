@@ -0,0 +1,115 @@
+#ifndef FLATCOMPOSITE_H
+#define FLATCOMPOSITE_H
+
+// Description:
+// Composite tree stored flat. Nodes are kept in pre-order in parallel arrays
+// (name, leaf flag, parent, end of subtree) instead of one heap object per
+// node linked through lists. The subtree of node i is the index range
+// [i, subtreeEnd(i)), its first child is i + 1 and the next sibling of a
+// child c is subtreeEnd(c). A full traversal is a linear scan, and any
+// subtree can be cut into contiguous chunks processed by several threads.
+
+// Usage:
+// 1. the tree has millions of nodes and is walked far more often than its
+// shape changes.
+// 2. you need Composite/Leaf objects at the edges: fromTree() and toTree()
+// convert in both directions.
+// Nodes are appended in pre-order with beginComposite()/addLeaf()/
+// endComposite(); there is no insertion in the middle.
+
+#include "Composite.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+class FlatComposite {
+public:
+  static constexpr std::uint32_t kNoParent = 0xffffffffu;
+
+  // Copies a pointer-based tree. Throws std::invalid_argument for node types
+  // other than Composite and Leaf.
+  static FlatComposite fromTree(const ComponentComposite& root);
+
+  // Builds Composite/Leaf objects. Element 0 is the root; the vector owns
+  // every node since Composite doesn't own its children.
+  std::vector<std::unique_ptr<ComponentComposite>> toTree() const;
+
+  std::uint32_t beginComposite(std::string name);
+  std::uint32_t addLeaf(std::string name);
+  void endComposite();
+
+  void reserve(std::size_t nodes);
+
+  // Same output as Composite::operation() on the equivalent tree.
+  void operation() const;
+
+  std::size_t size() const { return names_.size(); }
+  const std::string& name(std::uint32_t node) const { return names_[node]; }
+  bool isLeaf(std::uint32_t node) const { return leaf_[node] != 0; }
+  std::uint32_t parent(std::uint32_t node) const { return parents_[node]; }
+  std::uint32_t subtreeEnd(std::uint32_t node) const { return ends_[node]; }
+
+  template<typename TFunction>
+  void forEachChild(std::uint32_t node, TFunction&& function) const {
+    for (std::uint32_t child = node + 1; child < ends_[node];
+         child = ends_[child]) {
+      function(child);
+    }
+  }
+
+  // Calls function(index) for every node of the subtree, in pre-order.
+  template<typename TFunction>
+  void forEach(std::uint32_t node, TFunction&& function) const {
+    for (std::uint32_t i = node; i < ends_[node]; ++i) { function(i); }
+  }
+
+  // Splits the subtree into one contiguous chunk per thread. function must be
+  // safe to call concurrently for different nodes; order is unspecified.
+  template<typename TFunction>
+  void parallelForEach(std::uint32_t node, TFunction function,
+      unsigned threads = std::thread::hardware_concurrency()) const {
+    const std::uint32_t begin = node;
+    const std::uint32_t end = ends_[node];
+    const std::uint32_t count = end - begin;
+    threads = std::max(1u, std::min<unsigned>(threads, count / kMinChunk));
+    if (threads <= 1) {
+      forEach(node, function);
+      return;
+    }
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    const std::uint32_t chunk = (count + threads - 1) / threads;
+    for (unsigned t = 1; t < threads; ++t) {
+      std::uint32_t first = begin + t * chunk;
+      std::uint32_t last = std::min(end, first + chunk);
+      workers.emplace_back([first, last, &function] {
+        for (std::uint32_t i = first; i < last; ++i) { function(i); }
+      });
+    }
+    for (std::uint32_t i = begin; i < std::min(end, begin + chunk); ++i) {
+      function(i);
+    }
+    for (std::thread& worker : workers) { worker.join(); }
+  }
+
+private:
+  // Below this many nodes per thread, spawning threads costs more than it
+  // saves.
+  static constexpr std::uint32_t kMinChunk = 4096;
+
+  std::uint32_t append(std::string name, bool leaf);
+
+  std::vector<std::string> names_;
+  std::vector<std::uint8_t> leaf_;
+  std::vector<std::uint32_t> parents_;
+  std::vector<std::uint32_t> ends_;
+  std::vector<std::uint32_t> open_;  // composites not yet ended
+};
+
+#endif
@@ -0,0 +1 @@
+#include "InstrumentedChain.hpp"
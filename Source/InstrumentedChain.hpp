@@ -0,0 +1,175 @@
+#ifndef INSTRUMENTEDCHAIN_H
+#define INSTRUMENTEDCHAIN_H
+
+// Description:
+// Instrumented Chain of Responsibility. Handlers follow the same concept as
+// StaticChain (accepts()/process()), but the chain is assembled at runtime and
+// every handler keeps counters: how often it was asked, how often it took the
+// request and how much time it spent processing. With the adaptive policy on,
+// the chain periodically moves frequently hit handlers to the front so the
+// average request passes fewer handlers.
+
+// Usage:
+// 1. you want to know which handlers of a chain actually do the work.
+// 2. the order given by setNext() puts hot handlers at the end.
+// 3. handlers whose predicates never overlap may be reordered freely; mark
+// the others as fixed and they act as barriers nothing is moved across.
+
+#include "ChainOfResponsibility.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+class InstrumentedChain {
+public:
+  struct HandlerMetrics {
+    std::string name;
+    std::size_t position;
+    std::uint64_t visits;  // accepts() calls
+    std::uint64_t hits;    // requests processed
+    std::uint64_t nanoseconds;  // time spent in process()
+  };
+
+  // reorderable == true promises that the handler's predicate doesn't overlap
+  // with any other reorderable handler. A terminal handler (no accepts())
+  // must be added last and is never moved.
+  template<typename THandler>
+  void add(std::string name, THandler handler, bool reorderable = true) {
+    if (!slots_.empty() && slots_.back().terminal) {
+      throw std::logic_error("no handler can follow a terminal handler");
+    }
+    Slot slot;
+    slot.name = std::move(name);
+    if constexpr (IsTerminalHandler<THandler>::value) {
+      slot.accepts = [](int) { return true; };
+      slot.terminal = true;
+      slot.reorderable = false;
+    } else {
+      slot.accepts = [handler](int request) {
+        return handler.accepts(request);
+      };
+      slot.reorderable = reorderable;
+    }
+    slot.process = [handler](int request) { handler.process(request); };
+    slots_.push_back(std::move(slot));
+  }
+
+  void handle(int request) {
+    ++requests_;
+    bool handled = false;
+    for (Slot& slot : slots_) {
+      ++slot.visits;
+      if (slot.accepts(request)) {
+        auto start = std::chrono::steady_clock::now();
+        slot.process(request);
+        slot.nanoseconds += static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count());
+        ++slot.hits;
+        ++slot.recentHits;
+        handled = true;
+        break;
+      }
+    }
+    if (!handled) { ++unhandled_; }
+    if (adaptive_ && ++sinceReorder_ >= reorderInterval_) { reorder(); }
+  }
+
+  // Reorders every reorderInterval requests.
+  void setAdaptive(bool enabled, std::size_t reorderInterval = 4096) {
+    adaptive_ = enabled;
+    reorderInterval_ = reorderInterval ? reorderInterval : 1;
+    sinceReorder_ = 0;
+  }
+
+  // Sorts each run of reorderable handlers by recent hit count. Recent counts
+  // are halved afterwards so the order follows shifts in the traffic.
+  void reorder() {
+    auto runBegin = slots_.begin();
+    while (runBegin != slots_.end()) {
+      if (!runBegin->reorderable) {
+        ++runBegin;
+        continue;
+      }
+      auto runEnd = std::find_if(runBegin, slots_.end(),
+          [](const Slot& slot) { return !slot.reorderable; });
+      std::stable_sort(runBegin, runEnd, [](const Slot& a, const Slot& b) {
+        return a.recentHits > b.recentHits;
+      });
+      runBegin = runEnd;
+    }
+    for (Slot& slot : slots_) { slot.recentHits /= 2; }
+    sinceReorder_ = 0;
+    ++reorders_;
+  }
+
+  std::vector<HandlerMetrics> metrics() const {
+    std::vector<HandlerMetrics> result;
+    result.reserve(slots_.size());
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+      const Slot& slot = slots_[i];
+      result.push_back(HandlerMetrics{
+          slot.name, i, slot.visits, slot.hits, slot.nanoseconds});
+    }
+    return result;
+  }
+
+  // Average number of handlers asked per request.
+  double averageHops() const {
+    if (requests_ == 0) { return 0.0; }
+    std::uint64_t visits = 0;
+    for (const Slot& slot : slots_) { visits += slot.visits; }
+    return static_cast<double>(visits) / static_cast<double>(requests_);
+  }
+
+  std::uint64_t unhandledCount() const { return unhandled_; }
+  std::uint64_t reorderCount() const { return reorders_; }
+
+  // CSV: one line per handler in current chain order.
+  void exportMetrics(std::ostream& out) const {
+    out << "position,name,visits,hits,nanoseconds\n";
+    for (const HandlerMetrics& metric : metrics()) {
+      out << metric.position << ',' << metric.name << ',' << metric.visits
+          << ',' << metric.hits << ',' << metric.nanoseconds << '\n';
+    }
+  }
+
+  void resetMetrics() {
+    for (Slot& slot : slots_) {
+      slot.visits = slot.hits = slot.nanoseconds = slot.recentHits = 0;
+    }
+    requests_ = unhandled_ = 0;
+  }
+
+private:
+  struct Slot {
+    std::string name;
+    std::function<bool(int)> accepts;
+    std::function<void(int)> process;
+    bool reorderable = true;
+    bool terminal = false;
+    std::uint64_t visits = 0;
+    std::uint64_t hits = 0;
+    std::uint64_t nanoseconds = 0;
+    std::uint64_t recentHits = 0;
+  };
+
+  std::vector<Slot> slots_;
+  bool adaptive_ = false;
+  std::size_t reorderInterval_ = 4096;
+  std::size_t sinceReorder_ = 0;
+  std::uint64_t requests_ = 0;
+  std::uint64_t unhandled_ = 0;
+  std::uint64_t reorders_ = 0;
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include "InstrumentedDecorator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <nlohmann/json.hpp>
+
+LatencyHistogram::Summary LatencyHistogram::summary() const {
+  Summary summary{};
+  std::uint64_t total = 0;
+  for (const Stripe& stripe : stripes_) {
+    total += stripe.total.load(std::memory_order_relaxed);
+    summary.maxNanoseconds = std::max(
+        summary.maxNanoseconds, stripe.max.load(std::memory_order_relaxed));
+  }
+  for (std::uint64_t count : mergedCounts()) { summary.count += count; }
+  if (summary.count > 0) { summary.meanNanoseconds = total / summary.count; }
+  summary.p50Nanoseconds = percentile(0.5);
+  summary.p90Nanoseconds = percentile(0.9);
+  summary.p99Nanoseconds = percentile(0.99);
+  summary.p999Nanoseconds = percentile(0.999);
+  return summary;
+}
+
+std::uint64_t LatencyHistogram::percentile(double fraction) const {
+  std::vector<std::uint64_t> counts = mergedCounts();
+  std::uint64_t count = 0;
+  for (std::uint64_t bucketCount : counts) { count += bucketCount; }
+  if (count == 0) { return 0; }
+  fraction = std::min(std::max(fraction, 0.0), 1.0);
+  std::uint64_t rank = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(
+             std::ceil(fraction * static_cast<double>(count))));
+  std::uint64_t seen = 0;
+  std::uint64_t max = 0;
+  for (const Stripe& stripe : stripes_) {
+    max = std::max(max, stripe.max.load(std::memory_order_relaxed));
+  }
+  for (std::size_t bucket = 0; bucket < counts.size(); ++bucket) {
+    seen += counts[bucket];
+    if (seen >= rank) {
+      if (bucket + 1 == kBuckets) { return max; }
+      return std::min(max, bucketLowerBound(bucket + 1) - 1);
+    }
+  }
+  return max;
+}
+
+void LatencyHistogram::reset() {
+  for (Stripe& stripe : stripes_) {
+    for (auto& count : stripe.counts) {
+      count.store(0, std::memory_order_relaxed);
+    }
+    stripe.total.store(0, std::memory_order_relaxed);
+    stripe.max.store(0, std::memory_order_relaxed);
+  }
+}
+
+std::uint64_t LatencyHistogram::bucketLowerBound(std::size_t bucket) {
+  if (bucket < kSubBuckets) { return bucket; }
+  std::size_t exponent = bucket / kSubBuckets + kSubBucketBits - 1;
+  std::uint64_t sub = bucket % kSubBuckets;
+  return (kSubBuckets + sub) << (exponent - kSubBucketBits);
+}
+
+std::vector<std::uint64_t> LatencyHistogram::mergedCounts() const {
+  std::vector<std::uint64_t> counts(kBuckets, 0);
+  for (const Stripe& stripe : stripes_) {
+    for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+      counts[bucket] += stripe.counts[bucket].load(std::memory_order_relaxed);
+    }
+  }
+  return counts;
+}
+
+std::uint64_t CallCounter::value() const {
+  std::uint64_t total = 0;
+  for (const Stripe& stripe : stripes_) {
+    total += stripe.count.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+void CallCounter::reset() {
+  for (Stripe& stripe : stripes_) {
+    stripe.count.store(0, std::memory_order_relaxed);
+  }
+}
+
+void SampleTrace::record(const Sample& sample) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (samples_.size() == capacity_) { samples_.pop_front(); }
+  samples_.push_back(sample);
+}
+
+std::vector<SampleTrace::Sample> SampleTrace::samples() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::vector<Sample>(samples_.begin(), samples_.end());
+}
+
+void SampleTrace::reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  samples_.clear();
+  calls_.store(0, std::memory_order_relaxed);
+}
+
+LatencyHistogram& InstrumentationRegistry::histogram(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& histogram = histograms_[name];
+  if (!histogram) { histogram.reset(new LatencyHistogram()); }
+  return *histogram;
+}
+
+CallCounter& InstrumentationRegistry::counter(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& counter = counters_[name];
+  if (!counter) { counter.reset(new CallCounter()); }
+  return *counter;
+}
+
+SampleTrace& InstrumentationRegistry::trace(
+    const std::string& name, std::uint64_t period, std::size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& trace = traces_[name];
+  if (!trace) { trace.reset(new SampleTrace(period, capacity)); }
+  return *trace;
+}
+
+void InstrumentationRegistry::writeText(std::ostream& out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& entry : histograms_) {
+    LatencyHistogram::Summary summary = entry.second->summary();
+    out << "histogram " << entry.first << ": count " << summary.count
+        << ", mean " << summary.meanNanoseconds << " ns, p50 "
+        << summary.p50Nanoseconds << " ns, p90 " << summary.p90Nanoseconds
+        << " ns, p99 " << summary.p99Nanoseconds << " ns, p99.9 "
+        << summary.p999Nanoseconds << " ns, max " << summary.maxNanoseconds
+        << " ns\n";
+  }
+  for (const auto& entry : counters_) {
+    out << "counter " << entry.first << ": " << entry.second->value() << '\n';
+  }
+  for (const auto& entry : traces_) {
+    const SampleTrace& trace = *entry.second;
+    std::vector<SampleTrace::Sample> samples = trace.samples();
+    out << "trace " << entry.first << ": 1 in " << trace.period() << ", "
+        << trace.calls() << " calls, " << samples.size() << " samples kept\n";
+    for (const SampleTrace::Sample& sample : samples) {
+      out << "  call " << sample.call << " took "
+          << sample.durationNanoseconds << " ns on thread " << sample.stripe
+          << '\n';
+    }
+  }
+}
+
+void InstrumentationRegistry::writeJson(std::ostream& out) const {
+  nlohmann::json report;
+  report["histograms"] = nlohmann::json::object();
+  report["counters"] = nlohmann::json::object();
+  report["traces"] = nlohmann::json::object();
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& entry : histograms_) {
+    LatencyHistogram::Summary summary = entry.second->summary();
+    report["histograms"][entry.first] = {{"count", summary.count},
+        {"mean_ns", summary.meanNanoseconds},
+        {"p50_ns", summary.p50Nanoseconds},
+        {"p90_ns", summary.p90Nanoseconds},
+        {"p99_ns", summary.p99Nanoseconds},
+        {"p999_ns", summary.p999Nanoseconds},
+        {"max_ns", summary.maxNanoseconds}};
+  }
+  for (const auto& entry : counters_) {
+    report["counters"][entry.first] = entry.second->value();
+  }
+  for (const auto& entry : traces_) {
+    const SampleTrace& trace = *entry.second;
+    nlohmann::json samples = nlohmann::json::array();
+    for (const SampleTrace::Sample& sample : trace.samples()) {
+      samples.push_back({{"call", sample.call},
+          {"start_ns", sample.startNanoseconds},
+          {"duration_ns", sample.durationNanoseconds},
+          {"thread", sample.stripe}});
+    }
+    report["traces"][entry.first] = {{"period", trace.period()},
+        {"calls", trace.calls()}, {"samples", samples}};
+  }
+  out << report.dump(2) << '\n';
+}
+
+void InstrumentationRegistry::reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& entry : histograms_) { entry.second->reset(); }
+  for (auto& entry : counters_) { entry.second->reset(); }
+  for (auto& entry : traces_) { entry.second->reset(); }
+}
@@ -0,0 +1,255 @@
+#ifndef INSTRUMENTEDDECORATOR_H
+#define INSTRUMENTEDDECORATOR_H
+
+// Description:
+// Decorators that profile any Component without touching its code:
+// TimingDecorator records every Operation() into a latency histogram,
+// CountingDecorator counts calls and SamplingDecorator times one call in N
+// and keeps the most recent samples. Metrics are created by name in the
+// InstrumentationRegistry singleton, which prints them as text or JSON.
+// Decorators sharing a name share the metric.
+
+// Usage:
+// 1. you need latency percentiles or call rates of components in production.
+// 2. instrumentation must cost nothing measurable when it's switched off:
+// with InstrumentationRegistry::setEnabled(false) every decorator is a
+// relaxed atomic load and one branch in front of the wrapped call.
+// The histogram is log-linear (HDR style): 8 sub-buckets per power of two,
+// so a percentile is accurate to 12.5%. Recording is lock-free: threads are
+// spread over per-thread stripes of relaxed atomic counters.
+
+#include "Decorator.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Stripe of the calling thread, assigned round-robin on first use.
+inline std::size_t instrumentationStripe() {
+  static std::atomic<std::size_t> next{0};
+  thread_local std::size_t stripe =
+      next.fetch_add(1, std::memory_order_relaxed);
+  return stripe;
+}
+
+class LatencyHistogram {
+public:
+  static constexpr std::size_t kSubBucketBits = 3;
+  static constexpr std::size_t kSubBuckets = std::size_t(1) << kSubBucketBits;
+  static constexpr std::size_t kBuckets = (64 - kSubBucketBits + 1) *
+                                          kSubBuckets;
+  static constexpr std::size_t kStripes = 8;
+
+  struct Summary {
+    std::uint64_t count;
+    std::uint64_t meanNanoseconds;
+    std::uint64_t p50Nanoseconds;
+    std::uint64_t p90Nanoseconds;
+    std::uint64_t p99Nanoseconds;
+    std::uint64_t p999Nanoseconds;
+    std::uint64_t maxNanoseconds;
+  };
+
+  void record(std::uint64_t nanoseconds) {
+    Stripe& stripe = stripes_[instrumentationStripe() % kStripes];
+    stripe.counts[bucketOf(nanoseconds)].fetch_add(
+        1, std::memory_order_relaxed);
+    stripe.total.fetch_add(nanoseconds, std::memory_order_relaxed);
+    std::uint64_t max = stripe.max.load(std::memory_order_relaxed);
+    while (nanoseconds > max &&
+           !stripe.max.compare_exchange_weak(
+               max, nanoseconds, std::memory_order_relaxed)) { }
+  }
+
+  // A snapshot; recording may go on concurrently.
+  Summary summary() const;
+  // Upper bound of the bucket holding the given fraction of samples.
+  std::uint64_t percentile(double fraction) const;
+  void reset();
+
+  static std::size_t bucketOf(std::uint64_t value) {
+    if (value < kSubBuckets) { return static_cast<std::size_t>(value); }
+    std::size_t exponent = 63;
+    while (!(value >> exponent)) { --exponent; }
+    std::size_t sub = static_cast<std::size_t>(
+        (value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+    return (exponent - kSubBucketBits + 1) * kSubBuckets + sub;
+  }
+  static std::uint64_t bucketLowerBound(std::size_t bucket);
+
+private:
+  struct alignas(64) Stripe {
+    std::array<std::atomic<std::uint64_t>, kBuckets> counts{};
+    std::atomic<std::uint64_t> total{0};
+    std::atomic<std::uint64_t> max{0};
+  };
+
+  std::vector<std::uint64_t> mergedCounts() const;
+
+  std::array<Stripe, kStripes> stripes_;
+};
+
+class CallCounter {
+public:
+  void increment() {
+    stripes_[instrumentationStripe() % kStripes].count.fetch_add(
+        1, std::memory_order_relaxed);
+  }
+  std::uint64_t value() const;
+  void reset();
+
+private:
+  static constexpr std::size_t kStripes = 8;
+  struct alignas(64) Stripe {
+    std::atomic<std::uint64_t> count{0};
+  };
+  std::array<Stripe, kStripes> stripes_;
+};
+
+class SampleTrace {
+public:
+  struct Sample {
+    std::uint64_t call;  // index of the sampled call
+    std::uint64_t startNanoseconds;  // steady clock
+    std::uint64_t durationNanoseconds;
+    std::size_t stripe;  // thread
+  };
+
+  SampleTrace(std::uint64_t period, std::size_t capacity) :
+      period_(period ? period : 1), capacity_(capacity ? capacity : 1) { }
+
+  // Returns the call's index when it should be sampled, otherwise 0 is
+  // returned and the call isn't. Indices start at 1.
+  std::uint64_t sample() {
+    std::uint64_t call = calls_.fetch_add(1, std::memory_order_relaxed) + 1;
+    return call % period_ == 0 ? call : 0;
+  }
+
+  void record(const Sample& sample);
+  std::vector<Sample> samples() const;
+  std::uint64_t period() const { return period_; }
+  std::uint64_t calls() const { return calls_.load(std::memory_order_relaxed); }
+  void reset();
+
+private:
+  const std::uint64_t period_;
+  const std::size_t capacity_;
+  std::atomic<std::uint64_t> calls_{0};
+  mutable std::mutex mutex_;
+  std::deque<Sample> samples_;  // newest last
+};
+
+class InstrumentationRegistry {
+public:
+  static InstrumentationRegistry& getInstance() {
+    static InstrumentationRegistry instance;
+    return instance;
+  }
+
+  InstrumentationRegistry(InstrumentationRegistry const&) = delete;
+  void operator=(InstrumentationRegistry const&) = delete;
+
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+  static void setEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  // Create the metric on first use; references stay valid.
+  LatencyHistogram& histogram(const std::string& name);
+  CallCounter& counter(const std::string& name);
+  // period and capacity only apply when the trace is created.
+  SampleTrace& trace(const std::string& name, std::uint64_t period = 100,
+      std::size_t capacity = 1024);
+
+  void writeText(std::ostream& out) const;
+  void writeJson(std::ostream& out) const;
+  void reset();
+
+private:
+  InstrumentationRegistry() = default;
+
+  inline static std::atomic<bool> enabled_{true};
+
+  mutable std::mutex mutex_;
+  std::map<std::string, std::unique_ptr<LatencyHistogram>> histograms_;
+  std::map<std::string, std::unique_ptr<CallCounter>> counters_;
+  std::map<std::string, std::unique_ptr<SampleTrace>> traces_;
+};
+
+inline std::uint64_t instrumentationNow() {
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+class TimingDecorator : public Decorator {
+public:
+  TimingDecorator(std::shared_ptr<Component> comp, const std::string& name) :
+      Decorator(comp),
+      histogram_(InstrumentationRegistry::getInstance().histogram(name)) { }
+
+  void Operation() const override {
+    if (!InstrumentationRegistry::enabled()) {
+      component->Operation();
+      return;
+    }
+    std::uint64_t start = instrumentationNow();
+    component->Operation();
+    histogram_.record(instrumentationNow() - start);
+  }
+
+private:
+  LatencyHistogram& histogram_;
+};
+
+class CountingDecorator : public Decorator {
+public:
+  CountingDecorator(std::shared_ptr<Component> comp, const std::string& name) :
+      Decorator(comp),
+      counter_(InstrumentationRegistry::getInstance().counter(name)) { }
+
+  void Operation() const override {
+    if (InstrumentationRegistry::enabled()) { counter_.increment(); }
+    component->Operation();
+  }
+
+private:
+  CallCounter& counter_;
+};
+
+class SamplingDecorator : public Decorator {
+public:
+  SamplingDecorator(std::shared_ptr<Component> comp, const std::string& name,
+      std::uint64_t period = 100, std::size_t capacity = 1024) :
+      Decorator(comp),
+      trace_(InstrumentationRegistry::getInstance().trace(
+          name, period, capacity)) { }
+
+  void Operation() const override {
+    std::uint64_t call;
+    if (!InstrumentationRegistry::enabled() || !(call = trace_.sample())) {
+      component->Operation();
+      return;
+    }
+    std::uint64_t start = instrumentationNow();
+    component->Operation();
+    trace_.record(SampleTrace::Sample{call, start, instrumentationNow() - start,
+        instrumentationStripe()});
+  }
+
+private:
+  SampleTrace& trace_;
+};
+
+#endif
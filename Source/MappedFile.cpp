@@ -0,0 +1,52 @@
+#include "MappedFile.hpp"
+
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifndef _WIN32
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno == ENOENT) { return; }
+    throw std::system_error(
+        errno, std::generic_category(), "cannot open " + path);
+  }
+  struct stat info;
+  if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+    void* address = ::mmap(nullptr, static_cast<std::size_t>(info.st_size),
+        PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address != MAP_FAILED) {
+      ::madvise(address, static_cast<std::size_t>(info.st_size),
+          MADV_SEQUENTIAL);
+      data_ = static_cast<const unsigned char*>(address);
+      size_ = static_cast<std::size_t>(info.st_size);
+      mapped_ = true;
+    }
+  }
+  ::close(fd);
+  if (mapped_) { return; }
+#endif
+  std::ifstream file(path, std::ios::binary);
+  if (!file) { return; }
+  fallback_.assign(std::istreambuf_iterator<char>(file),
+      std::istreambuf_iterator<char>());
+  data_ = fallback_.data();
+  size_ = fallback_.size();
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (mapped_) {
+    ::munmap(const_cast<unsigned char*>(data_), size_);
+  }
+#endif
+}
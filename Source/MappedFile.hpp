@@ -0,0 +1,27 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file; mmap where available.
+class MappedFile {
+public:
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const unsigned char* data() const { return data_; }
+  std::size_t size() const { return size_; }
+
+private:
+  const unsigned char* data_ = nullptr;
+  std::size_t size_ = 0;
+  std::vector<unsigned char> fallback_;  // used when mapping isn't possible
+  bool mapped_ = false;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "MessageBus.hpp"
+
+#include <string>
+#include <utility>
+
+void BusColleague::subscribe(std::uint32_t topic) {
+  if (bus_.sealed()) {
+    throw std::logic_error("cannot subscribe after the bus is sealed");
+  }
+  if (topic >= bus_.topicCount()) {
+    throw std::out_of_range("topic " + std::to_string(topic) + " is unknown");
+  }
+  topics_[topic] = true;
+}
+
+void BusColleague::advertise(std::uint32_t topic) {
+  if (bus_.sealed()) {
+    throw std::logic_error("cannot advertise after the bus is sealed");
+  }
+  if (topic >= bus_.topicCount()) {
+    throw std::out_of_range("topic " + std::to_string(topic) + " is unknown");
+  }
+  advertised_[topic] = true;
+}
+
+void BusColleague::checkTopic(std::uint32_t topic) const {
+  if (!bus_.sealed()) {
+    throw std::logic_error("cannot publish before the bus is sealed");
+  }
+  if (topic >= bus_.topicCount()) {
+    throw std::out_of_range("topic " + std::to_string(topic) + " is unknown");
+  }
+  if (!advertised_[topic]) {
+    throw std::logic_error(
+        "topic " + std::to_string(topic) + " is not advertised");
+  }
+}
+
+MessageBus::MessageBus(std::uint32_t topicCount, std::size_t queueCapacity) :
+    topicCount_(topicCount), queueCapacity_(queueCapacity) { }
+
+BusColleague& MessageBus::join() {
+  if (sealed_) {
+    throw std::logic_error("cannot join after the bus is sealed");
+  }
+  std::uint32_t id = static_cast<std::uint32_t>(colleagues_.size());
+  colleagues_.emplace_back(new BusColleague(*this, id));
+  colleagues_.back()->topics_.assign(topicCount_, false);
+  colleagues_.back()->advertised_.assign(topicCount_, false);
+  return *colleagues_.back();
+}
+
+void MessageBus::seal() {
+  if (sealed_) { return; }
+  const std::size_t count = colleagues_.size();
+
+  // outbound[publisher]: (subscriber, queue) for each subscriber sharing a
+  // topic with the publisher, in subscriber order.
+  using Outbound = std::pair<std::size_t, SpscQueue<BusMessage>*>;
+  std::vector<std::vector<Outbound>> outbound(count);
+  for (std::size_t subscriber = 0; subscriber < count; ++subscriber) {
+    BusColleague& colleague = *colleagues_[subscriber];
+    for (std::size_t publisher = 0; publisher < count; ++publisher) {
+      const std::vector<bool>& advertised = colleagues_[publisher]->advertised_;
+      bool routed = false;
+      for (std::uint32_t topic = 0; topic < topicCount_ && !routed; ++topic) {
+        routed = advertised[topic] && colleague.topics_[topic];
+      }
+      if (!routed) { continue; }
+      colleague.inbound_.emplace_back(
+          new SpscQueue<BusMessage>(queueCapacity_));
+      outbound[publisher].emplace_back(
+          subscriber, colleague.inbound_.back().get());
+    }
+  }
+
+  for (std::size_t publisher = 0; publisher < count; ++publisher) {
+    BusColleague& colleague = *colleagues_[publisher];
+    colleague.routeOffsets_.assign(topicCount_ + 1, 0);
+    for (std::uint32_t topic = 0; topic < topicCount_; ++topic) {
+      colleague.routeOffsets_[topic] =
+          static_cast<std::uint32_t>(colleague.routes_.size());
+      if (!colleague.advertised_[topic]) { continue; }
+      for (const Outbound& route : outbound[publisher]) {
+        if (colleagues_[route.first]->topics_[topic]) {
+          colleague.routes_.push_back(route.second);
+        }
+      }
+    }
+    colleague.routeOffsets_[topicCount_] =
+        static_cast<std::uint32_t>(colleague.routes_.size());
+  }
+  sealed_ = true;
+}
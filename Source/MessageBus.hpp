@@ -0,0 +1,248 @@
+#ifndef MESSAGEBUS_H
+#define MESSAGEBUS_H
+
+// Description:
+// Mediator grown into an in-process message bus. Colleagues subscribe to
+// numbered topics and publish typed payloads; the bus routes each message to
+// every subscriber of its topic. Routing is precomputed when the bus is
+// sealed: each publisher gets a table from topic to the queues of that
+// topic's subscribers. Publishers advertise the topics they publish on, and
+// every (publisher, subscriber) pair sharing a topic gets its own bounded
+// single-producer/single-consumer queue; pairs without one get none, so
+// memory grows with the routes rather than with the square of the colleague
+// count. Publishing is a few relaxed loads and one release store per
+// subscriber, with no lock and no allocation.
+
+// Usage:
+// 1. colleagues run on their own threads and talk only through the bus.
+// 2. the set of colleagues and subscriptions is known before traffic starts.
+// Rules: join(), advertise() and subscribe() before seal(); publish only
+// after it, and only on advertised topics. Each
+// colleague publishes from one thread and polls from one thread (they may be
+// different). Messages from one publisher arrive in order; there is no order
+// between publishers. Payloads are trivially copyable and at most
+// BusMessage::kPayloadCapacity bytes, checked at compile time.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Address of id identifies a payload type without RTTI.
+template<typename T>
+struct BusPayloadType {
+  static const char id;
+};
+template<typename T>
+const char BusPayloadType<T>::id = 0;
+
+struct BusMessage {
+  static constexpr std::size_t kPayloadCapacity = 48;
+
+  std::uint32_t topic = 0;
+  std::uint32_t sender = 0;
+  const void* type = nullptr;
+  alignas(std::max_align_t) unsigned char payload[kPayloadCapacity];
+
+  template<typename T>
+  bool holds() const { return type == &BusPayloadType<T>::id; }
+
+  // Throws std::logic_error if the message carries another type.
+  template<typename T>
+  T as() const {
+    if (!holds<T>()) {
+      throw std::logic_error("bus message holds another payload type");
+    }
+    T value;
+    std::memcpy(&value, payload, sizeof(T));
+    return value;
+  }
+};
+
+// Bounded single-producer/single-consumer ring. Each side caches the other
+// side's cursor and only reloads it when the ring looks full or empty.
+template<typename T>
+class SpscQueue {
+public:
+  explicit SpscQueue(std::size_t capacity) :
+      mask_(roundUpToPowerOfTwo(capacity) - 1), slots_(mask_ + 1) { }
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  bool tryPush(const T& item) {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cachedHead_ > mask_) {
+      cachedHead_ = head_.load(std::memory_order_acquire);
+      if (tail - cachedHead_ > mask_) { return false; }  // full
+    }
+    slots_[tail & mask_] = item;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryPop(T& item) {
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cachedTail_) {
+      cachedTail_ = tail_.load(std::memory_order_acquire);
+      if (head == cachedTail_) { return false; }  // empty
+    }
+    item = slots_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+private:
+  static std::size_t roundUpToPowerOfTwo(std::size_t value) {
+    std::size_t result = 2;
+    while (result < value) { result <<= 1; }
+    return result;
+  }
+
+  const std::size_t mask_;
+  std::vector<T> slots_;
+  alignas(64) std::atomic<std::size_t> head_{0};
+  std::size_t cachedTail_ = 0;  // consumer side
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  std::size_t cachedHead_ = 0;  // producer side
+};
+
+class MessageBus;
+
+class BusColleague {
+public:
+  BusColleague(const BusColleague&) = delete;
+  BusColleague& operator=(const BusColleague&) = delete;
+
+  std::uint32_t id() const { return id_; }
+
+  void subscribe(std::uint32_t topic);
+  // Declares that this colleague publishes on the topic.
+  void advertise(std::uint32_t topic);
+
+  // Delivers to every subscriber whose queue has room. Returns false if the
+  // message had to be dropped for at least one of them.
+  template<typename T>
+  bool tryPublish(std::uint32_t topic, const T& payload) {
+    BusMessage message = makeMessage(topic, payload);
+    bool delivered = true;
+    for (std::uint32_t i = routeOffsets_[topic]; i < routeOffsets_[topic + 1];
+         ++i) {
+      if (!routes_[i]->tryPush(message)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        delivered = false;
+      }
+    }
+    return delivered;
+  }
+
+  // Waits for room in every subscriber's queue. Don't use it for a topic
+  // this colleague subscribes to itself unless another thread polls it.
+  template<typename T>
+  void publish(std::uint32_t topic, const T& payload) {
+    BusMessage message = makeMessage(topic, payload);
+    for (std::uint32_t i = routeOffsets_[topic]; i < routeOffsets_[topic + 1];
+         ++i) {
+      while (!routes_[i]->tryPush(message)) { std::this_thread::yield(); }
+    }
+  }
+
+  // Hands up to maxMessages received messages to handler(const BusMessage&)
+  // and returns how many there were. Inbound queues are visited round-robin
+  // so a busy publisher can't starve the others.
+  template<typename THandler>
+  std::size_t poll(THandler&& handler,
+      std::size_t maxMessages = std::numeric_limits<std::size_t>::max()) {
+    std::size_t received = 0;
+    std::size_t idle = 0;
+    BusMessage message;
+    while (received < maxMessages && idle < inbound_.size()) {
+      SpscQueue<BusMessage>& queue = *inbound_[nextInbound_];
+      if (++nextInbound_ == inbound_.size()) { nextInbound_ = 0; }
+      if (queue.tryPop(message)) {
+        handler(static_cast<const BusMessage&>(message));
+        ++received;
+        idle = 0;
+      } else {
+        ++idle;
+      }
+    }
+    return received;
+  }
+
+  std::uint64_t droppedCount() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+private:
+  friend class MessageBus;
+
+  BusColleague(MessageBus& bus, std::uint32_t id) : bus_(bus), id_(id) { }
+
+  template<typename T>
+  BusMessage makeMessage(std::uint32_t topic, const T& payload) const {
+    static_assert(std::is_trivially_copyable<T>::value,
+        "bus payloads must be trivially copyable");
+    static_assert(sizeof(T) <= BusMessage::kPayloadCapacity,
+        "payload does not fit into BusMessage");
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+        "payload is over-aligned for BusMessage");
+    checkTopic(topic);
+    BusMessage message;
+    message.topic = topic;
+    message.sender = id_;
+    message.type = &BusPayloadType<T>::id;
+    std::memcpy(message.payload, &payload, sizeof(T));
+    return message;
+  }
+
+  void checkTopic(std::uint32_t topic) const;
+
+  MessageBus& bus_;
+  std::uint32_t id_;
+  std::vector<bool> topics_;  // subscriptions
+  std::vector<bool> advertised_;  // publications
+  // One inbound queue per publisher advertising a topic this one subscribes.
+  std::vector<std::unique_ptr<SpscQueue<BusMessage>>> inbound_;
+  std::size_t nextInbound_ = 0;
+  // Dispatch table: subscriber queues of topic t are
+  // routes_[routeOffsets_[t] .. routeOffsets_[t + 1]).
+  std::vector<std::uint32_t> routeOffsets_;
+  std::vector<SpscQueue<BusMessage>*> routes_;
+  std::atomic<std::uint64_t> dropped_{0};
+};
+
+class MessageBus {
+public:
+  MessageBus(std::uint32_t topicCount, std::size_t queueCapacity = 1024);
+
+  MessageBus(const MessageBus&) = delete;
+  MessageBus& operator=(const MessageBus&) = delete;
+
+  // The bus owns its colleagues; the reference stays valid for its lifetime.
+  BusColleague& join();
+
+  // Builds the queues and dispatch tables. Subscriptions and advertised
+  // topics are fixed afterwards.
+  void seal();
+
+  bool sealed() const { return sealed_; }
+  std::uint32_t topicCount() const { return topicCount_; }
+  std::size_t colleagueCount() const { return colleagues_.size(); }
+
+private:
+  std::uint32_t topicCount_;
+  std::size_t queueCapacity_;
+  bool sealed_ = false;
+  std::vector<std::unique_ptr<BusColleague>> colleagues_;
+};
+
+#endif
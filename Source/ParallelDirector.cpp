@@ -0,0 +1,124 @@
+#include "ParallelDirector.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+// State of one construct() call; it lives on the caller's stack.
+struct ParallelDirector::Run {
+  explicit Run(std::size_t steps) :
+      pending(new std::atomic<std::size_t>[steps]),
+      skipped(new std::atomic<bool>[steps]), remaining(steps) { }
+
+  std::unique_ptr<std::atomic<std::size_t>[]> pending;  // unfinished deps
+  std::unique_ptr<std::atomic<bool>[]> skipped;  // a dependency failed
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::size_t remaining;
+  std::exception_ptr error;
+};
+
+std::size_t ParallelDirector::addStep(
+    std::string name, Step step, std::vector<std::size_t> dependsOn) {
+  std::size_t id = m_steps.size();
+  for (std::size_t dependency : dependsOn) {
+    if (dependency >= id) {
+      throw std::out_of_range("step " + name + " depends on unknown step " +
+                              std::to_string(dependency));
+    }
+  }
+  for (std::size_t dependency : dependsOn) {
+    m_steps[dependency].dependents.push_back(id);
+  }
+  m_steps.push_back(
+      StepNode{std::move(name), std::move(step), dependsOn.size(), {}});
+  return id;
+}
+
+std::size_t ParallelDirector::addBuilderParts() {
+  std::size_t first =
+      addStep("part1", [](Builder& builder) { builder.buildPart1(); });
+  addStep("part2", [](Builder& builder) { builder.buildPart2(); });
+  addStep("part3", [](Builder& builder) { builder.buildPart3(); });
+  return first;
+}
+
+void ParallelDirector::construct() {
+  if (m_steps.empty()) { return; }
+  if (!m_builder) {
+    throw std::logic_error("ParallelDirector has no builder");
+  }
+
+  Run run(m_steps.size());
+  std::vector<std::size_t> roots;
+  for (std::size_t id = 0; id < m_steps.size(); ++id) {
+    run.pending[id].store(m_steps[id].dependencies, std::memory_order_relaxed);
+    run.skipped[id].store(false, std::memory_order_relaxed);
+    if (m_steps[id].dependencies == 0) { roots.push_back(id); }
+  }
+
+  // The caller runs steps too; whatever the executor doesn't take stays
+  // with it.
+  runSteps(run, std::move(roots));
+
+  std::unique_lock<std::mutex> lock(run.mutex);
+  run.finished.wait(lock, [&run] { return run.remaining == 0; });
+  if (run.error) { std::rethrow_exception(run.error); }
+}
+
+// Never blocks: a full queue or a stopped executor leaves the step with the
+// caller. Blocking here could deadlock once every worker waits for room in a
+// queue only workers drain.
+bool ParallelDirector::offload(Run& run, std::size_t id) {
+  Run* state = &run;
+  try {
+    return m_executor.trySubmit([this, state, id] {
+      runSteps(*state, std::vector<std::size_t>{id});
+    });
+  } catch (...) { return false; }
+}
+
+// Runs the ready steps, offering all but one of them to the executor first.
+// Dependents a step releases join the ready steps of this thread.
+void ParallelDirector::runSteps(Run& run, std::vector<std::size_t> steps) {
+  while (!steps.empty()) {
+    while (steps.size() > 1 && offload(run, steps.back())) { steps.pop_back(); }
+    const std::size_t id = steps.back();
+    steps.pop_back();
+
+    bool succeeded = !run.skipped[id].load(std::memory_order_relaxed);
+    if (succeeded) {
+      try {
+        m_steps[id].step(*m_builder);
+      } catch (...) {
+        succeeded = false;
+        std::lock_guard<std::mutex> lock(run.mutex);
+        if (!run.error) { run.error = std::current_exception(); }
+      }
+    }
+
+    for (std::size_t dependent : m_steps[id].dependents) {
+      if (!succeeded) {
+        run.skipped[dependent].store(true, std::memory_order_relaxed);
+      }
+      // acq_rel: the last dependency to finish publishes every part written
+      // so far (and the skipped flag) to whoever runs the dependent.
+      if (run.pending[dependent].fetch_sub(1, std::memory_order_acq_rel) ==
+          1) {
+        steps.push_back(dependent);
+      }
+    }
+
+    // Once remaining hits zero construct() may return and destroy run, so
+    // nothing touches it after this block. It can't hit zero while steps
+    // holds anything: those steps haven't finished.
+    {
+      std::lock_guard<std::mutex> lock(run.mutex);
+      if (--run.remaining == 0) { run.finished.notify_all(); }
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#ifndef PARALLELDIRECTOR_H
+#define PARALLELDIRECTOR_H
+
+// Description:
+// Director that runs build steps concurrently. Director::construct() calls
+// buildPart1/2/3 one after another; ParallelDirector is given the steps
+// together with the steps each one depends on, and construct() hands every
+// step whose dependencies have finished to a CommandExecutor; the calling
+// thread runs steps too instead of idling. Independent steps therefore run
+// side by side, a dependent step starts as soon as its last dependency is
+// done, and construct() returns only when every step has finished, so
+// getProduct() afterwards sees all parts.
+
+// Usage:
+// 1. the parts of a product are expensive and (mostly) independent.
+// 2. the builder tolerates concurrent calls of independent steps: e.g. every
+// step writes its own member of the product, like ConcreteBuilder does.
+// A step may only depend on steps added before it, so the graph can't have a
+// cycle. If a step throws, the steps depending on it are skipped, the others
+// still run, and construct() rethrows the first exception. A step the
+// executor can't take (full queue, shut down) runs on the thread that made it
+// ready, so construct() never waits for queue space. It does wait for the
+// steps it queued, so don't call it from a task of the same executor.
+
+#include "Builder.hpp"
+#include "CommandExecutor.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+class ParallelDirector {
+public:
+  using Step = std::function<void(Builder&)>;
+
+  explicit ParallelDirector(CommandExecutor& executor) :
+      m_executor(executor) { }
+
+  ParallelDirector(const ParallelDirector&) = delete;
+  ParallelDirector& operator=(const ParallelDirector&) = delete;
+
+  void setBuilder(Builder* builder) { m_builder = builder; }
+
+  // Returns the step's id. Throws std::out_of_range when a dependency isn't
+  // the id of an earlier step.
+  std::size_t addStep(std::string name, Step step,
+      std::vector<std::size_t> dependsOn = {});
+
+  // buildPart1/2/3 as three independent steps; returns the first id.
+  std::size_t addBuilderParts();
+
+  // Runs every step once and waits for all of them.
+  void construct();
+
+  std::size_t stepCount() const { return m_steps.size(); }
+  const std::string& stepName(std::size_t id) const {
+    return m_steps.at(id).name;
+  }
+
+private:
+  struct StepNode {
+    std::string name;
+    Step step;
+    std::size_t dependencies;
+    std::vector<std::size_t> dependents;
+  };
+
+  struct Run;
+
+  bool offload(Run& run, std::size_t id);
+  void runSteps(Run& run, std::vector<std::size_t> steps);
+
+  CommandExecutor& m_executor;
+  Builder* m_builder = nullptr;
+  std::vector<StepNode> m_steps;
+};
+
+#endif
@@ -0,0 +1 @@
+#include "PersistentVector.hpp"
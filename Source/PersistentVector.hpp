@@ -0,0 +1,122 @@
+#ifndef PERSISTENTVECTOR_H
+#define PERSISTENTVECTOR_H
+
+// Description:
+// Vector with structural sharing: a 32-way trie of reference counted nodes.
+// Copying a PersistentVector copies only the root pointer. A write copies the
+// nodes on the path to the element if (and only if) they are shared with
+// another copy, so after taking a snapshot the cost of the snapshot is paid
+// lazily, proportional to the data that actually changes.
+
+// Usage:
+// 1. many versions (snapshots, undo levels) of a large array must be kept.
+// 2. consecutive versions differ in a small part of the data.
+// Node sharing is decided by use_count(), so a vector and all its copies
+// must stay on one thread.
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+template<typename T>
+class PersistentVector {
+public:
+  static constexpr std::size_t kBits = 5;
+  static constexpr std::size_t kBranching = std::size_t(1) << kBits;
+  static constexpr std::size_t kMask = kBranching - 1;
+
+  PersistentVector() = default;
+
+  PersistentVector(std::size_t count, const T& value) {
+    for (std::size_t i = 0; i < count; ++i) { push_back(value); }
+  }
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const T& operator[](std::size_t index) const {
+    const Node* node = root_.get();
+    for (std::size_t shift = depth_ * kBits; shift > 0; shift -= kBits) {
+      node = node->children[(index >> shift) & kMask].get();
+    }
+    return node->values[index & kMask];
+  }
+
+  const T& at(std::size_t index) const {
+    if (index >= size_) {
+      throw std::out_of_range("PersistentVector index out of range");
+    }
+    return (*this)[index];
+  }
+
+  void set(std::size_t index, T value) {
+    if (index >= size_) {
+      throw std::out_of_range("PersistentVector index out of range");
+    }
+    leafFor(index).values[index & kMask] = std::move(value);
+  }
+
+  void push_back(T value) {
+    if (size_ == capacity()) { grow(); }
+    Node& leaf = leafFor(size_);
+    if (leaf.values.empty()) { leaf.values.reserve(kBranching); }
+    leaf.values.push_back(std::move(value));
+    ++size_;
+  }
+
+  // True when both vectors still point at the very same root, i.e. one is an
+  // untouched snapshot of the other.
+  bool sharesRootWith(const PersistentVector& other) const {
+    return root_ == other.root_;
+  }
+
+private:
+  struct Node {
+    std::vector<std::shared_ptr<Node>> children;
+    std::vector<T> values;
+  };
+
+  std::size_t capacity() const {
+    return root_ ? std::size_t(1) << ((depth_ + 1) * kBits) : 0;
+  }
+
+  void grow() {
+    if (!root_) {
+      root_ = std::make_shared<Node>();
+      return;
+    }
+    auto newRoot = std::make_shared<Node>();
+    newRoot->children.resize(kBranching);
+    newRoot->children[0] = std::move(root_);
+    root_ = std::move(newRoot);
+    ++depth_;
+  }
+
+  // Copies the node behind slot when somebody else holds it too.
+  static void makeUnique(std::shared_ptr<Node>& slot, bool branch) {
+    if (!slot) {
+      slot = std::make_shared<Node>();
+      if (branch) { slot->children.resize(kBranching); }
+    } else if (slot.use_count() > 1) {
+      slot = std::make_shared<Node>(*slot);
+    }
+  }
+
+  // Unique (writable) leaf holding index; creates missing nodes.
+  Node& leafFor(std::size_t index) {
+    std::shared_ptr<Node>* slot = &root_;
+    makeUnique(*slot, depth_ > 0);
+    for (std::size_t shift = depth_ * kBits; shift > 0; shift -= kBits) {
+      slot = &(*slot)->children[(index >> shift) & kMask];
+      makeUnique(*slot, shift > kBits);
+    }
+    return **slot;
+  }
+
+  std::shared_ptr<Node> root_;
+  std::size_t depth_ = 0;  // branch levels above the leaves
+  std::size_t size_ = 0;
+};
+
+#endif
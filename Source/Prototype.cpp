@@ -1 +1,120 @@
 #include "Prototype.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Below this many clones per thread, spawning threads costs more than it
+// saves.
+constexpr std::size_t kMinChunk = 4096;
+
+}  // namespace
+
+Prototype* Prototype::cloneIntoN(void* storage, std::size_t count) const {
+  auto bytes = static_cast<unsigned char*>(storage);
+  const std::size_t stride = cloneSize();
+  std::vector<Prototype*> made;
+  made.reserve(count);
+  try {
+    for (std::size_t i = 0; i < count; ++i) {
+      made.push_back(cloneInto(bytes + i * stride));
+    }
+  } catch (...) {
+    for (Prototype* clone : made) { clone->~Prototype(); }
+    throw;
+  }
+  return made.empty() ? nullptr : made.front();
+}
+
+PrototypeBatch Prototype::cloneN(std::size_t n, unsigned threads) const {
+  PrototypeBatch batch;
+  if (n == 0) { return batch; }
+  // sizeof is a multiple of alignof, so clones can sit back to back.
+  const std::size_t stride = cloneSize();
+  const std::size_t alignment = cloneAlignment();
+  if (n > std::numeric_limits<std::size_t>::max() / stride) {
+    throw std::bad_array_new_length();
+  }
+  auto storage = static_cast<unsigned char*>(
+      ::operator new(n * stride, std::align_val_t(alignment)));
+
+  std::size_t workers = std::max<std::size_t>(
+      1, std::min<std::size_t>(threads, n / kMinChunk));
+  const std::size_t chunk = (n + workers - 1) / workers;
+  workers = (n + chunk - 1) / chunk;
+  std::vector<Prototype*> firsts(workers, nullptr);
+  std::vector<std::exception_ptr> errors(workers);
+  auto fill = [&](std::size_t t) {
+    std::size_t first = t * chunk;
+    try {
+      firsts[t] = cloneIntoN(
+          storage + first * stride, std::min(chunk, n - first));
+    } catch (...) { errors[t] = std::current_exception(); }
+  };
+  std::vector<std::thread> threadPool;
+  threadPool.reserve(workers - 1);
+  for (std::size_t t = 1; t < workers; ++t) {
+    threadPool.emplace_back(fill, t);
+  }
+  fill(0);
+  for (std::thread& thread : threadPool) { thread.join(); }
+
+  auto failed = std::find_if(errors.begin(), errors.end(),
+      [](const std::exception_ptr& error) { return error != nullptr; });
+  if (failed != errors.end()) {
+    // A failed chunk has already destroyed its own clones.
+    for (std::size_t t = 0; t < workers; ++t) {
+      if (errors[t]) { continue; }
+      auto clone = reinterpret_cast<unsigned char*>(firsts[t]);
+      for (std::size_t i = t * chunk; i < std::min(n, (t + 1) * chunk);
+           ++i, clone += stride) {
+        reinterpret_cast<Prototype*>(clone)->~Prototype();
+      }
+    }
+    ::operator delete(storage, std::align_val_t(alignment));
+    std::rethrow_exception(*failed);
+  }
+
+  batch.storage_ = storage;
+  batch.first_ = reinterpret_cast<unsigned char*>(firsts.front());
+  batch.size_ = n;
+  batch.stride_ = stride;
+  batch.alignment_ = alignment;
+  return batch;
+}
+
+PrototypeBatch::~PrototypeBatch() { release(); }
+
+PrototypeBatch::PrototypeBatch(PrototypeBatch&& other) noexcept :
+    storage_(std::exchange(other.storage_, nullptr)),
+    first_(std::exchange(other.first_, nullptr)),
+    size_(std::exchange(other.size_, 0)), stride_(other.stride_),
+    alignment_(other.alignment_) { }
+
+PrototypeBatch& PrototypeBatch::operator=(PrototypeBatch&& other) noexcept {
+  if (this != &other) {
+    release();
+    storage_ = std::exchange(other.storage_, nullptr);
+    first_ = std::exchange(other.first_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    stride_ = other.stride_;
+    alignment_ = other.alignment_;
+  }
+  return *this;
+}
+
+void PrototypeBatch::release() {
+  for (Prototype& clone : *this) { clone.~Prototype(); }
+  if (storage_) {
+    ::operator delete(storage_, std::align_val_t(alignment_));
+  }
+  storage_ = nullptr;
+  first_ = nullptr;
+  size_ = 0;
+}
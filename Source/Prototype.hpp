@@ -1,8 +1,16 @@
 #ifndef PROTOTYPE_H
 #define PROTOTYPE_H
 
+#include "CopyOnWrite.hpp"
+
+#include <cstddef>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
 
 // Description:
 // Prototype is a creational design pattern that
@@ -18,12 +26,97 @@
 // 4. When you want to avoid a constructor telescoping anti-pattern.
 // 5. When you want to avoid a factory class hierarchy.
 
+class PrototypeBatch;
+
 class Prototype {
 public:
   Prototype() { std::cout << "Prototype instantiated" << std::endl; }
   virtual ~Prototype() = default;
   virtual std::unique_ptr<Prototype> clone() const = 0;
   virtual void print() const = 0;
+
+  // Silent clone constructed in place: storage holds cloneSize() bytes aligned
+  // to cloneAlignment(). Whoever owns the storage calls the destructor.
+  virtual Prototype* cloneInto(void* storage) const = 0;
+  virtual std::size_t cloneSize() const = 0;
+  virtual std::size_t cloneAlignment() const = 0;
+  // count silent clones side by side, cloneSize() bytes apart. Returns the
+  // first one; if a copy throws, the clones made so far are destroyed.
+  // Subclasses override it with a plain loop of copy constructions.
+  virtual Prototype* cloneIntoN(void* storage, std::size_t count) const;
+
+  // n silent clones in one allocation. With threads > 1 the buffer is split
+  // into one chunk per thread, each at least 4096 clones long. Throws
+  // std::bad_array_new_length if n clones don't fit into a size_t.
+  PrototypeBatch cloneN(std::size_t n, unsigned threads = 1) const;
+};
+
+// Owns the clones made by Prototype::cloneN() and their buffer; a range of
+// Prototype& over them.
+class PrototypeBatch {
+public:
+  class Iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Prototype;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Prototype*;
+    using reference = Prototype&;
+
+    Iterator(unsigned char* position, std::size_t stride) :
+        position_(position), stride_(stride) { }
+
+    Prototype& operator*() const {
+      return *reinterpret_cast<Prototype*>(position_);
+    }
+    Prototype* operator->() const {
+      return reinterpret_cast<Prototype*>(position_);
+    }
+    Iterator& operator++() {
+      position_ += stride_;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old = *this;
+      position_ += stride_;
+      return old;
+    }
+    bool operator==(const Iterator& other) const {
+      return position_ == other.position_;
+    }
+    bool operator!=(const Iterator& other) const {
+      return position_ != other.position_;
+    }
+
+  private:
+    unsigned char* position_;
+    std::size_t stride_;
+  };
+
+  PrototypeBatch() = default;
+  ~PrototypeBatch();
+  PrototypeBatch(PrototypeBatch&& other) noexcept;
+  PrototypeBatch& operator=(PrototypeBatch&& other) noexcept;
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  Prototype& operator[](std::size_t index) const {
+    return *reinterpret_cast<Prototype*>(first_ + index * stride_);
+  }
+  Iterator begin() const { return Iterator(first_, stride_); }
+  Iterator end() const { return Iterator(first_ + size_ * stride_, stride_); }
+
+private:
+  friend class Prototype;
+
+  void release();
+
+  unsigned char* storage_ = nullptr;
+  unsigned char* first_ = nullptr;  // Prototype subobject of the first clone
+  std::size_t size_ = 0;
+  std::size_t stride_ = 0;
+  std::size_t alignment_ = 0;
 };
 
 class ConcretePrototype1 : public Prototype {
@@ -40,6 +133,21 @@ public:
     return std::make_unique<ConcretePrototype1>(*this);
   }
 
+  Prototype* cloneInto(void* storage) const override {
+    return new (storage) ConcretePrototype1(*this);
+  }
+  std::size_t cloneSize() const override {
+    return sizeof(ConcretePrototype1);
+  }
+  std::size_t cloneAlignment() const override {
+    return alignof(ConcretePrototype1);
+  }
+  Prototype* cloneIntoN(void* storage, std::size_t count) const override {
+    auto clones = static_cast<ConcretePrototype1*>(storage);
+    std::uninitialized_fill_n(clones, count, *this);
+    return clones;
+  }
+
   virtual void print() const override {
     std::cout << "ConcretePrototype1 printed" << std::endl;
   }
@@ -59,10 +167,80 @@ public:
     return std::make_unique<ConcretePrototype2>(*this);
   }
 
+  Prototype* cloneInto(void* storage) const override {
+    return new (storage) ConcretePrototype2(*this);
+  }
+  std::size_t cloneSize() const override {
+    return sizeof(ConcretePrototype2);
+  }
+  std::size_t cloneAlignment() const override {
+    return alignof(ConcretePrototype2);
+  }
+  Prototype* cloneIntoN(void* storage, std::size_t count) const override {
+    auto clones = static_cast<ConcretePrototype2*>(storage);
+    std::uninitialized_fill_n(clones, count, *this);
+    return clones;
+  }
+
   virtual void print() const override {
     std::cout << "ConcretePrototype2 printed" << std::endl;
   }
 };
 
+// State of a CowPrototype. Clones share it until one of them writes.
+struct CowPrototypeState {
+  std::string name;
+  std::vector<double> values;
+};
+
+// Prototype with large state in copy-on-write mode: cloning copies a pointer
+// and bumps a reference count, the setters copy the state on first write.
+class CowPrototype : public Prototype {
+public:
+  CowPrototype(std::string name, std::vector<double> values) :
+      m_state(CowPrototypeState{std::move(name), std::move(values)}) {
+    std::cout << "CowPrototype instantiated" << std::endl;
+  }
+  CowPrototype(const CowPrototype& prototype [[maybe_unused]]) = default;
+  virtual ~CowPrototype() = default;
+
+  std::unique_ptr<Prototype> clone() const override {
+    std::cout << "CowPrototype cloned" << std::endl;
+    return std::make_unique<CowPrototype>(*this);
+  }
+
+  Prototype* cloneInto(void* storage) const override {
+    return new (storage) CowPrototype(*this);
+  }
+  std::size_t cloneSize() const override { return sizeof(CowPrototype); }
+  std::size_t cloneAlignment() const override { return alignof(CowPrototype); }
+  Prototype* cloneIntoN(void* storage, std::size_t count) const override {
+    auto clones = static_cast<CowPrototype*>(storage);
+    std::uninitialized_fill_n(clones, count, *this);
+    return clones;
+  }
+
+  virtual void print() const override {
+    std::cout << "CowPrototype " << name() << " printed (" << values().size()
+              << " values, " << (m_state.shared() ? "shared" : "own")
+              << " state)" << std::endl;
+  }
+
+  const std::string& name() const { return m_state.read().name; }
+  const std::vector<double>& values() const { return m_state.read().values; }
+
+  void setName(std::string name) { m_state.write().name = std::move(name); }
+  void setValue(std::size_t index, double value) {
+    m_state.write().values.at(index) = value;
+  }
+
+  bool sharesStateWith(const CowPrototype& other) const {
+    return m_state.sharesWith(other.m_state);
+  }
+
+private:
+  CopyOnWrite<CowPrototypeState> m_state;
+};
+
 // Tomáš Mark (c) 2025
 #endif
\ No newline at end of file
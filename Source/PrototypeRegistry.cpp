@@ -0,0 +1,225 @@
+#include "PrototypeRegistry.hpp"
+
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+std::size_t slabAlignment(std::size_t alignment) {
+  return std::max(alignment, alignof(void*));
+}
+
+}  // namespace
+
+PrototypeSlab::PrototypeSlab(std::size_t slotSize, std::size_t slotAlignment,
+    std::size_t slotsPerChunk) :
+    slotSize_((std::max(slotSize, sizeof(void*)) +
+                  slabAlignment(slotAlignment) - 1) /
+              slabAlignment(slotAlignment) * slabAlignment(slotAlignment)),
+    slotAlignment_(slabAlignment(slotAlignment)),
+    slotsPerChunk_(slotsPerChunk ? slotsPerChunk : 1) { }
+
+PrototypeSlab::~PrototypeSlab() {
+  for (void* chunk : chunks_) {
+    ::operator delete(chunk, std::align_val_t(slotAlignment_));
+  }
+}
+
+void* PrototypeSlab::allocate() {
+  if (!free_) {
+    auto chunk = static_cast<unsigned char*>(::operator new(
+        slotSize_ * slotsPerChunk_, std::align_val_t(slotAlignment_)));
+    chunks_.push_back(chunk);
+    // Chain the new slots so that the first one is handed out first.
+    for (std::size_t i = slotsPerChunk_; i-- > 0;) {
+      deallocate(chunk + i * slotSize_);
+    }
+  }
+  void* slot = free_;
+  free_ = *static_cast<void**>(slot);
+  return slot;
+}
+
+void PrototypeSlab::deallocate(void* slot) {
+  *static_cast<void**>(slot) = free_;
+  free_ = slot;
+}
+
+struct PrototypeRegistry::Entry {
+  Entry(std::unique_ptr<Prototype> original, std::size_t slotsPerChunk) :
+      prototype(std::move(original)),
+      slab(prototype->cloneSize(), prototype->cloneAlignment(),
+          slotsPerChunk) { }
+
+  ~Entry() {
+    for (Prototype* clone : ready) { destroy(clone); }
+  }
+
+  // Lock held.
+  void destroy(Prototype* clone) {
+    // The slot starts at the most derived object, not necessarily at the
+    // Prototype subobject.
+    void* slot = dynamic_cast<void*>(clone);
+    clone->~Prototype();
+    slab.deallocate(slot);
+  }
+
+  const std::unique_ptr<Prototype> prototype;
+  std::mutex mutex;
+  PrototypeSlab slab;
+  std::vector<Prototype*> ready;
+  bool refillQueued = false;
+  PrototypeRegistryStats stats;
+};
+
+void PrototypeRegistry::Releaser::operator()(Prototype* clone) const {
+  std::lock_guard<std::mutex> lock(entry_->mutex);
+  entry_->destroy(clone);
+}
+
+PrototypeRegistry::PrototypeRegistry(
+    std::size_t poolSize, std::size_t slotsPerChunk) :
+    poolSize_(poolSize), slotsPerChunk_(slotsPerChunk),
+    refiller_([this] { refillLoop(); }) { }
+
+PrototypeRegistry::~PrototypeRegistry() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wanted_.notify_one();
+  refiller_.join();
+}
+
+void PrototypeRegistry::add(
+    const std::string& name, std::unique_ptr<Prototype> prototype) {
+  if (!prototype) {
+    throw std::invalid_argument("prototype " + name + " is null");
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.count(name)) {
+      throw std::invalid_argument(
+          "prototype " + name + " is already registered");
+    }
+  }
+  auto entry = std::make_unique<Entry>(std::move(prototype), slotsPerChunk_);
+  refill(*entry);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!entries_.emplace(name, std::move(entry)).second) {
+    throw std::invalid_argument("prototype " + name + " is already registered");
+  }
+}
+
+PrototypeRegistry::Clone PrototypeRegistry::clone(const std::string& name) {
+  Entry& entry = this->entry(name);
+  std::unique_lock<std::mutex> lock(entry.mutex);
+  Prototype* clone = nullptr;
+  void* slot = nullptr;
+  if (!entry.ready.empty()) {
+    clone = entry.ready.back();
+    entry.ready.pop_back();
+    ++entry.stats.hits;
+  } else {
+    slot = entry.slab.allocate();
+    ++entry.stats.misses;
+  }
+  bool wantRefill = poolSize_ && !entry.refillQueued &&
+                    entry.ready.size() <= poolSize_ / 2;
+  if (wantRefill) { entry.refillQueued = true; }
+  lock.unlock();
+
+  if (wantRefill) {
+    {
+      std::lock_guard<std::mutex> registryLock(mutex_);
+      refills_.push_back(&entry);
+    }
+    wanted_.notify_one();
+  }
+
+  if (!clone) {
+    try {
+      clone = entry.prototype->cloneInto(slot);
+    } catch (...) {
+      lock.lock();
+      entry.slab.deallocate(slot);
+      throw;
+    }
+  }
+  return Clone(clone, Releaser(&entry));
+}
+
+const Prototype& PrototypeRegistry::prototype(const std::string& name) const {
+  return *entry(name).prototype;
+}
+
+std::size_t PrototypeRegistry::pooled(const std::string& name) const {
+  Entry& entry = this->entry(name);
+  std::lock_guard<std::mutex> lock(entry.mutex);
+  return entry.ready.size();
+}
+
+PrototypeRegistryStats PrototypeRegistry::stats(const std::string& name) const {
+  Entry& entry = this->entry(name);
+  std::lock_guard<std::mutex> lock(entry.mutex);
+  return entry.stats;
+}
+
+PrototypeRegistry::Entry& PrototypeRegistry::entry(
+    const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(name);
+  if (it == entries_.end()) {
+    throw std::out_of_range("prototype " + name + " is not registered");
+  }
+  return *it->second;
+}
+
+void PrototypeRegistry::refillLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    wanted_.wait(lock, [this] { return stopping_ || !refills_.empty(); });
+    if (stopping_) { return; }
+    std::vector<Entry*> pending;
+    pending.swap(refills_);
+    lock.unlock();
+    for (Entry* entry : pending) { refill(*entry); }
+    lock.lock();
+  }
+}
+
+// Copies outside the entry's lock so clone() and releases carry on meanwhile.
+// A copy that throws ends the refill; clone() then misses and reports it.
+void PrototypeRegistry::refill(Entry& entry) {
+  std::vector<void*> slots;
+  {
+    std::lock_guard<std::mutex> lock(entry.mutex);
+    if (entry.ready.size() >= poolSize_) {
+      entry.refillQueued = false;
+      return;
+    }
+    try {
+      while (slots.size() < poolSize_ - entry.ready.size()) {
+        slots.push_back(entry.slab.allocate());
+      }
+    } catch (const std::bad_alloc&) { }
+  }
+
+  std::vector<Prototype*> made;
+  made.reserve(slots.size());
+  try {
+    for (void* slot : slots) {
+      made.push_back(entry.prototype->cloneInto(slot));
+    }
+  } catch (...) { }
+
+  std::lock_guard<std::mutex> lock(entry.mutex);
+  entry.ready.insert(entry.ready.end(), made.begin(), made.end());
+  entry.stats.refilled += made.size();
+  entry.refillQueued = false;
+  for (std::size_t i = made.size(); i < slots.size(); ++i) {
+    entry.slab.deallocate(slots[i]);
+  }
+}
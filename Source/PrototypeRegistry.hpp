@@ -0,0 +1,111 @@
+#ifndef PROTOTYPEREGISTRY_H
+#define PROTOTYPEREGISTRY_H
+
+// Description:
+// Prototypes registered by name, each with a pool of clones made in advance.
+// clone(name) normally pops a ready clone off the pool. A background thread
+// tops the pool up again once it is down to half of poolSize. Clones are
+// constructed with Prototype::cloneInto(), so nothing is printed, and they
+// live in slots of a slab owned by their prototype's entry rather than in
+// separate heap blocks. Destroying a clone gives its slot back to the slab.
+
+// Usage:
+// 1. the same few prototypes are cloned at high rates.
+// 2. the cost of copying a prototype can be paid ahead of time, off the
+// thread that needs the clone.
+// When the pool is empty clone() copies synchronously (a miss) instead of
+// waiting for the refill. The registry must outlive every clone it handed out.
+// Registered prototypes are read by the refill thread, so they must not be
+// changed after add().
+
+#include "Prototype.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Fixed-size slots carved from chunks; freed slots are chained through their
+// first bytes. Not thread-safe.
+class PrototypeSlab {
+public:
+  PrototypeSlab(std::size_t slotSize, std::size_t slotAlignment,
+      std::size_t slotsPerChunk);
+  ~PrototypeSlab();
+
+  PrototypeSlab(const PrototypeSlab&) = delete;
+  PrototypeSlab& operator=(const PrototypeSlab&) = delete;
+
+  void* allocate();
+  void deallocate(void* slot);
+  std::size_t capacity() const { return chunks_.size() * slotsPerChunk_; }
+
+private:
+  const std::size_t slotSize_;
+  const std::size_t slotAlignment_;
+  const std::size_t slotsPerChunk_;
+  std::vector<void*> chunks_;
+  void* free_ = nullptr;
+};
+
+struct PrototypeRegistryStats {
+  std::uint64_t hits = 0;     // clones taken from the pool
+  std::uint64_t misses = 0;   // clones made on the caller's thread
+  std::uint64_t refilled = 0; // clones made ahead of time
+};
+
+class PrototypeRegistry {
+  struct Entry;
+
+public:
+  // Destroys the clone and returns its slot to the slab.
+  class Releaser {
+  public:
+    Releaser() = default;
+    explicit Releaser(Entry* entry) : entry_(entry) { }
+    void operator()(Prototype* clone) const;
+
+  private:
+    Entry* entry_ = nullptr;
+  };
+  using Clone = std::unique_ptr<Prototype, Releaser>;
+
+  explicit PrototypeRegistry(
+      std::size_t poolSize = 64, std::size_t slotsPerChunk = 256);
+  ~PrototypeRegistry();
+
+  PrototypeRegistry(const PrototypeRegistry&) = delete;
+  PrototypeRegistry& operator=(const PrototypeRegistry&) = delete;
+
+  // Fills the prototype's pool before returning. Throws
+  // std::invalid_argument if the name is taken or the prototype is null.
+  void add(const std::string& name, std::unique_ptr<Prototype> prototype);
+
+  // Throws std::out_of_range for an unknown name.
+  Clone clone(const std::string& name);
+  const Prototype& prototype(const std::string& name) const;
+  std::size_t pooled(const std::string& name) const;
+  PrototypeRegistryStats stats(const std::string& name) const;
+
+private:
+  Entry& entry(const std::string& name) const;
+  void refillLoop();
+  void refill(Entry& entry);
+
+  const std::size_t poolSize_;
+  const std::size_t slotsPerChunk_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wanted_;
+  std::map<std::string, std::unique_ptr<Entry>> entries_;
+  std::vector<Entry*> refills_;  // entries waiting for the refill thread
+  bool stopping_ = false;
+  std::thread refiller_;  // last: started once all is set up
+};
+
+#endif
@@ -2,6 +2,9 @@
 #define STATE_H
 
 #include <iostream>
+#include <type_traits>
+#include <utility>
+#include <variant>
 
 class State {
 public:
@@ -37,4 +40,52 @@ private:
   State* state;
 };
 
+// Allocation-free alternative to ContextState. All states live inline in a
+// std::variant, so a transition is an in-place construction (no new/delete)
+// and request() dispatches through std::visit's jump table instead of a
+// virtual call. handle() is called qualified with the alternative's own type,
+// so even a polymorphic state is called directly, not through its vtable.
+// The ConcreteState classes above can be used as they are.
+// A state's handle() may return the next state (any of TStates); the
+// transition is applied after handle() has returned.
+template<typename... TStates>
+class VariantContextState {
+public:
+  using StateVariant = std::variant<TStates...>;
+
+  template<typename TInitial>
+  explicit VariantContextState(TInitial initial) :
+      state_(std::move(initial)) { }
+
+  template<typename TState, typename... TArgs>
+  void setState(TArgs&&... args) {
+    state_.template emplace<TState>(std::forward<TArgs>(args)...);
+  }
+
+  void request() {
+    std::visit(
+        [this](auto& state) {
+          using TState = std::decay_t<decltype(state)>;
+          using Result = decltype(state.TState::handle());
+          if constexpr (std::is_void<Result>::value) {
+            state.TState::handle();
+          } else {
+            Result next = state.TState::handle();
+            state_ = std::move(next);
+          }
+        },
+        state_);
+  }
+
+  template<typename TState>
+  bool isIn() const {
+    return std::holds_alternative<TState>(state_);
+  }
+
+  std::size_t index() const { return state_.index(); }
+
+private:
+  StateVariant state_;
+};
+
 #endif
\ No newline at end of file
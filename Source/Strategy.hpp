@@ -2,9 +2,11 @@
 #define STRATEGY_H
 
 #include <iostream>
+#include <utility>
 
 class Strategy {
 public:
+  virtual ~Strategy() { }
   virtual void algorithm() = 0;
 };
 
@@ -25,6 +27,14 @@ public:
 class Context {
 public:
   Context(Strategy* strategy) { this->strategy = strategy; }
+  ~Context() { delete strategy; }
+  Context(const Context&) = delete;
+  Context& operator=(const Context&) = delete;
+
+  void setStrategy(Strategy* strategy) {
+    delete this->strategy;
+    this->strategy = strategy;
+  }
 
   void contextInterface() { strategy->algorithm(); }
 
@@ -32,4 +42,21 @@ private:
   Strategy* strategy;
 };
 
-#endif
\ No newline at end of file
+// Context with the strategy fixed at compile time. The strategy is a member
+// of known type, so contextInterface() is a direct (inlinable) call even for
+// the ConcreteStrategy classes above. Any type with algorithm() works.
+template<typename TStrategy>
+class StaticContext {
+public:
+  explicit StaticContext(TStrategy strategy = TStrategy()) :
+      strategy_(std::move(strategy)) { }
+
+  void contextInterface() { strategy_.algorithm(); }
+
+  TStrategy& strategy() { return strategy_; }
+
+private:
+  TStrategy strategy_;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#include "StrategyRegistry.hpp"
+
+#include <stdexcept>
+
+void StrategyRegistry::add(
+    const std::string& name, std::unique_ptr<Strategy> strategy) {
+  if (!strategy) {
+    throw std::invalid_argument("strategy " + name + " is null");
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!strategies_.emplace(name, std::move(strategy)).second) {
+    throw std::invalid_argument("strategy " + name + " is already registered");
+  }
+}
+
+Strategy* StrategyRegistry::find(const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = strategies_.find(name);
+  return it == strategies_.end() ? nullptr : it->second.get();
+}
+
+std::vector<std::string> StrategyRegistry::names() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> result;
+  result.reserve(strategies_.size());
+  for (const auto& entry : strategies_) { result.push_back(entry.first); }
+  return result;
+}
+
+HotSwapContext::HotSwapContext(
+    const StrategyRegistry& registry, const std::string& name) :
+    registry_(registry), strategy_(nullptr) {
+  select(name);
+}
+
+void HotSwapContext::select(const std::string& name) {
+  Strategy* strategy = registry_.find(name);
+  if (!strategy) {
+    throw std::out_of_range("no strategy named " + name);
+  }
+  std::lock_guard<std::mutex> lock(nameMutex_);
+  strategy_.store(strategy, std::memory_order_release);
+  name_ = name;
+}
+
+std::string HotSwapContext::selected() const {
+  std::lock_guard<std::mutex> lock(nameMutex_);
+  return name_;
+}
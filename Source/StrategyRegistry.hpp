@@ -0,0 +1,61 @@
+#ifndef STRATEGYREGISTRY_H
+#define STRATEGYREGISTRY_H
+
+// Description:
+// Strategies selected by name at runtime. StrategyRegistry owns every
+// registered strategy for its whole lifetime; HotSwapContext only points at
+// one of them through an atomic pointer. select() swaps the pointer while
+// other threads keep calling contextInterface(), which takes no lock: a call
+// runs either the old or the new strategy, and the old one stays alive
+// because the registry never destroys a strategy before it is destroyed
+// itself.
+
+// Usage:
+// 1. the algorithm is chosen by configuration or swapped under load.
+// 2. register all candidates up front; registering and selecting take a
+// mutex, calling doesn't.
+// Strategies shared between threads must tolerate concurrent algorithm()
+// calls.
+
+#include "Strategy.hpp"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class StrategyRegistry {
+public:
+  // Throws std::invalid_argument if the name is already taken.
+  void add(const std::string& name, std::unique_ptr<Strategy> strategy);
+  // Returns nullptr for an unknown name.
+  Strategy* find(const std::string& name) const;
+  std::vector<std::string> names() const;
+
+private:
+  mutable std::mutex mutex_;
+  std::map<std::string, std::unique_ptr<Strategy>> strategies_;
+};
+
+class HotSwapContext {
+public:
+  HotSwapContext(const StrategyRegistry& registry, const std::string& name);
+
+  void contextInterface() {
+    strategy_.load(std::memory_order_acquire)->algorithm();
+  }
+
+  // Throws std::out_of_range for an unknown name.
+  void select(const std::string& name);
+  std::string selected() const;
+
+private:
+  const StrategyRegistry& registry_;
+  std::atomic<Strategy*> strategy_;
+  mutable std::mutex nameMutex_;
+  std::string name_;
+};
+
+#endif
@@ -0,0 +1 @@
+#include "TransitionTable.hpp"
@@ -0,0 +1,227 @@
+#ifndef TRANSITIONTABLE_H
+#define TRANSITIONTABLE_H
+
+// Description:
+// State machine declared as a table of (state, event) -> (next state, action)
+// rows instead of State subclasses calling setState(). The rows are compiled
+// into a dense state x event array by a constexpr constructor; when the table
+// is declared constexpr, a missing or duplicated (state, event) pair is a
+// compile error. Events are processed run-to-completion: an action may post
+// further events, which are queued and handled after the current transition
+// has finished.
+
+// Usage:
+// 1. the machine is fully specified up front (protocols, sessions, parsers).
+// 2. many small machines share one table: TableStateMachineBatch keeps their
+// states and contexts in separate arrays, so a dispatch over a million
+// instances streams through a compact state array.
+// States and events are enum classes whose last enumerator is Count.
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// FIFO of pending events. Storage is reused once the queue drains.
+template<typename TEvent>
+class EventQueue {
+public:
+  void post(TEvent event) { events_.push_back(event); }
+  bool empty() const { return head_ == events_.size(); }
+
+  TEvent pop() {
+    TEvent event = events_[head_++];
+    if (head_ == events_.size()) {
+      events_.clear();
+      head_ = 0;
+    }
+    return event;
+  }
+
+  void clear() {
+    events_.clear();
+    head_ = 0;
+  }
+
+private:
+  std::vector<TEvent> events_;
+  std::size_t head_ = 0;
+};
+
+template<typename TState, typename TEvent, typename TContext>
+struct Transition {
+  using Action = void (*)(TContext&, EventQueue<TEvent>&);
+
+  TState from;
+  TEvent event;
+  TState to;
+  Action action;  // may be null
+};
+
+template<typename TState, typename TEvent, typename TContext>
+class TransitionTable {
+public:
+  using Row = Transition<TState, TEvent, TContext>;
+  using Action = typename Row::Action;
+
+  struct Cell {
+    TState to;
+    Action action;
+  };
+
+  static constexpr std::size_t kStates =
+      static_cast<std::size_t>(TState::Count);
+  static constexpr std::size_t kEvents =
+      static_cast<std::size_t>(TEvent::Count);
+
+  // Throws on a bad table; in a constant expression that fails the build.
+  template<std::size_t N>
+  constexpr explicit TransitionTable(const Row (&rows)[N]) : cells_{} {
+    std::array<bool, kStates * kEvents> defined{};
+    for (std::size_t i = 0; i < N; ++i) {
+      if (static_cast<std::size_t>(rows[i].from) >= kStates ||
+          static_cast<std::size_t>(rows[i].to) >= kStates ||
+          static_cast<std::size_t>(rows[i].event) >= kEvents) {
+        throw std::logic_error("transition uses Count as a state or event");
+      }
+      std::size_t cell = index(rows[i].from, rows[i].event);
+      if (defined[cell]) {
+        throw std::logic_error("transition table has a duplicate row");
+      }
+      defined[cell] = true;
+      cells_[cell] = Cell{rows[i].to, rows[i].action};
+    }
+    for (std::size_t cell = 0; cell < defined.size(); ++cell) {
+      if (!defined[cell]) {
+        throw std::logic_error("transition table is incomplete");
+      }
+    }
+  }
+
+  constexpr const Cell& at(TState state, TEvent event) const {
+    return cells_[index(state, event)];
+  }
+
+private:
+  static constexpr std::size_t index(TState state, TEvent event) {
+    return static_cast<std::size_t>(state) * kEvents +
+           static_cast<std::size_t>(event);
+  }
+
+  std::array<Cell, kStates * kEvents> cells_;
+};
+
+// Single machine. post() called from inside an action only queues the event;
+// the outermost post() drains the queue.
+template<typename TState, typename TEvent, typename TContext>
+class TableStateMachine {
+public:
+  using Table = TransitionTable<TState, TEvent, TContext>;
+
+  TableStateMachine(
+      const Table& table, TState initial, TContext context = TContext()) :
+      table_(table), state_(initial), context_(std::move(context)) { }
+
+  void post(TEvent event) {
+    queue_.post(event);
+    if (processing_) { return; }
+    processing_ = true;
+    try {
+      while (!queue_.empty()) {
+        const auto& cell = table_.at(state_, queue_.pop());
+        state_ = cell.to;
+        if (cell.action) { cell.action(context_, queue_); }
+      }
+    } catch (...) {
+      queue_.clear();
+      processing_ = false;
+      throw;
+    }
+    processing_ = false;
+  }
+
+  TState state() const { return state_; }
+  TContext& context() { return context_; }
+  const TContext& context() const { return context_; }
+
+private:
+  const Table& table_;
+  TState state_;
+  TContext context_;
+  EventQueue<TEvent> queue_;
+  bool processing_ = false;
+};
+
+// Many independent machines sharing one table, stored as a struct of arrays.
+// Every dispatch runs the addressed instance to completion before moving on.
+template<typename TState, typename TEvent, typename TContext>
+class TableStateMachineBatch {
+public:
+  using Table = TransitionTable<TState, TEvent, TContext>;
+
+  explicit TableStateMachineBatch(const Table& table) : table_(table) { }
+
+  void reserve(std::size_t count) {
+    states_.reserve(count);
+    contexts_.reserve(count);
+  }
+
+  // Returns the instance id.
+  std::size_t add(TState initial, TContext context = TContext()) {
+    states_.push_back(initial);
+    contexts_.push_back(std::move(context));
+    return states_.size() - 1;
+  }
+
+  void dispatch(std::size_t instance, TEvent event) {
+    queue_.post(event);
+    drain(instance);
+  }
+
+  // Sends the same event to every instance.
+  void dispatch(TEvent event) {
+    for (std::size_t instance = 0; instance < states_.size(); ++instance) {
+      const auto& cell = table_.at(states_[instance], event);
+      states_[instance] = cell.to;
+      if (cell.action) {
+        cell.action(contexts_[instance], queue_);
+        drain(instance);
+      }
+    }
+  }
+
+  // Delivers events[i] to instances[i], in order.
+  void dispatch(const std::size_t* instances, const TEvent* events,
+      std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      dispatch(instances[i], events[i]);
+    }
+  }
+
+  std::size_t size() const { return states_.size(); }
+  TState state(std::size_t instance) const { return states_[instance]; }
+  TContext& context(std::size_t instance) { return contexts_[instance]; }
+  const std::vector<TState>& states() const { return states_; }
+
+private:
+  void drain(std::size_t instance) {
+    try {
+      while (!queue_.empty()) {
+        const auto& cell = table_.at(states_[instance], queue_.pop());
+        states_[instance] = cell.to;
+        if (cell.action) { cell.action(contexts_[instance], queue_); }
+      }
+    } catch (...) {
+      queue_.clear();
+      throw;
+    }
+  }
+
+  const Table& table_;
+  std::vector<TState> states_;
+  std::vector<TContext> contexts_;
+  EventQueue<TEvent> queue_;
+};
+
+#endif
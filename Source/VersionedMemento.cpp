@@ -0,0 +1 @@
+#include "VersionedMemento.hpp"
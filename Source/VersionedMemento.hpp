@@ -0,0 +1,111 @@
+#ifndef VERSIONEDMEMENTO_H
+#define VERSIONEDMEMENTO_H
+
+// Description:
+// Generic Memento/Caretaker keeping many versions of an arbitrary state type.
+// A memento is simply a copy of the state, so the cost of a checkpoint is the
+// cost of copying TState. Build TState from persistent structures such as
+// PersistentVector and that copy becomes a handful of pointer copies; the
+// data itself is shared between versions until it's modified. Restoring a
+// version assigns the stored copy back, which is again just pointer swaps.
+
+// Usage:
+// 1. the originator's state is large and hundreds of checkpoints are needed.
+// 2. you want to jump back to any of the last N checkpoints, not only the
+// latest one.
+
+#include "PersistentVector.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+template<typename TState>
+class VersionedMemento {
+public:
+  VersionedMemento(std::uint64_t version, TState state) :
+      version_(version), state_(std::move(state)) { }
+  std::uint64_t getVersion() const { return version_; }
+  const TState& getState() const { return state_; }
+
+private:
+  std::uint64_t version_;
+  TState state_;
+};
+
+template<typename TState>
+class VersionedOriginator {
+public:
+  VersionedOriginator() = default;
+  explicit VersionedOriginator(TState state) : state_(std::move(state)) { }
+
+  TState& state() { return state_; }
+  const TState& state() const { return state_; }
+
+  VersionedMemento<TState> createMemento(std::uint64_t version) const {
+    return VersionedMemento<TState>(version, state_);
+  }
+  void setMemento(const VersionedMemento<TState>& memento) {
+    state_ = memento.getState();
+  }
+
+private:
+  TState state_;
+};
+
+// Keeps the newest `capacity` mementos; older ones are dropped (and with them
+// any data no newer version shares).
+template<typename TState>
+class VersionedCaretaker {
+public:
+  VersionedCaretaker(
+      VersionedOriginator<TState>* originator, std::size_t capacity) :
+      originator_(originator), capacity_(capacity ? capacity : 1) { }
+
+  // Returns the version id of the checkpoint.
+  std::uint64_t saveState() {
+    if (history_.size() == capacity_) { history_.pop_front(); }
+    history_.push_back(originator_->createMemento(nextVersion_));
+    return nextVersion_++;
+  }
+
+  void restoreState() {
+    if (history_.empty()) {
+      throw std::logic_error("VersionedCaretaker has no saved state");
+    }
+    originator_->setMemento(history_.back());
+  }
+
+  void restoreState(std::uint64_t version) {
+    originator_->setMemento(find(version));
+  }
+
+  bool hasVersion(std::uint64_t version) const {
+    return !history_.empty() && version >= history_.front().getVersion() &&
+           version <= history_.back().getVersion();
+  }
+
+  std::size_t size() const { return history_.size(); }
+  std::size_t capacity() const { return capacity_; }
+
+private:
+  // Versions are consecutive, so lookup is an index computation.
+  const VersionedMemento<TState>& find(std::uint64_t version) const {
+    if (!hasVersion(version)) {
+      throw std::out_of_range(
+          "version " + std::to_string(version) + " is no longer kept");
+    }
+    return history_[static_cast<std::size_t>(
+        version - history_.front().getVersion())];
+  }
+
+  VersionedOriginator<TState>* originator_;
+  std::size_t capacity_;
+  std::deque<VersionedMemento<TState>> history_;
+  std::uint64_t nextVersion_ = 0;
+};
+
+#endif
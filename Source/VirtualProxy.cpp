@@ -0,0 +1 @@
+#include "VirtualProxy.hpp"
@@ -0,0 +1,81 @@
+#ifndef VIRTUALPROXY_H
+#define VIRTUALPROXY_H
+
+// Description:
+// Virtual proxy: the real subject is built only when it is first needed.
+// Proxy expects a ready shared_ptr<RealSubject>; VirtualProxy takes a
+// factory instead and runs it exactly once, however many threads ask at the
+// same time. A caller that knows the subject will be needed soon can call
+// prefetch(): construction then starts on a background thread, and the first
+// Request() only waits for whatever part of it is left. Once the subject
+// exists, Request() is an atomic load and a call.
+
+// Usage:
+// 1. the subject is expensive to construct (loads files, opens connections)
+// and many instances are never used.
+// 2. there is an earlier point where you can guess it will be used.
+// If the factory throws, every later use rethrows the same exception; the
+// factory isn't retried.
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+template<typename TSubject>
+class VirtualProxy {
+public:
+  using Factory = std::function<std::shared_ptr<TSubject>()>;
+
+  explicit VirtualProxy(
+      Factory factory = [] { return std::make_shared<TSubject>(); }) :
+      factory_(std::move(factory)) { }
+
+  // A prefetch still running is waited for.
+  ~VirtualProxy() = default;
+
+  VirtualProxy(const VirtualProxy&) = delete;
+  VirtualProxy& operator=(const VirtualProxy&) = delete;
+
+  void Request() { subject().Request(); }
+
+  TSubject& subject() {
+    if (TSubject* ready = ready_.load(std::memory_order_acquire)) {
+      return *ready;
+    }
+    start(std::launch::deferred);
+    // For a deferred start the first get() runs the factory here; concurrent
+    // callers block until it's done.
+    TSubject* subject = future_.get().get();
+    if (!subject) {
+      throw std::logic_error("VirtualProxy factory returned no subject");
+    }
+    ready_.store(subject, std::memory_order_release);
+    return *subject;
+  }
+
+  // Starts construction on another thread unless it has already started.
+  void prefetch() { start(std::launch::async); }
+
+  // True once subject() has returned the subject at least once.
+  bool constructed() const {
+    return ready_.load(std::memory_order_acquire) != nullptr;
+  }
+
+private:
+  void start(std::launch policy) {
+    std::call_once(started_, [this, policy] {
+      future_ = std::async(policy, factory_).share();
+    });
+  }
+
+  Factory factory_;
+  std::once_flag started_;
+  std::shared_future<std::shared_ptr<TSubject>> future_;
+  std::atomic<TSubject*> ready_{nullptr};
+};
+
+#endif